@@ -3,16 +3,24 @@
 in vec2 vTexCoord;
 out vec4 color;     //requirement of a fragment shader
 
-uniform sampler2D uPositionTexture;
+uniform usampler2D uPositionTexture;    // Escape iteration, 0 if inside
+uniform sampler2D uSmoothTexture;       // Fractional escape iteration, when uSmooth
 uniform sampler1D uColorTexture;
-uniform int uIteration;
+uniform int uIteration;                 // Counts from here up show as inside
+uniform bool uSmooth;
 
 void main()
 {
+	uint it = texture(uPositionTexture, vTexCoord).x;
+	float shade = (it >= uint(uIteration)) ? 0.0 : float(it);
+	if (uSmooth && shade > 0.0)
+	{
+		shade = texture(uSmoothTexture, vTexCoord).x;
+	}
+
+	// The ramp starts over every 2048 iterations, from its dark end, so late escapes keep colors
 	color = vec4(
-		vec3(texture(
-                uColorTexture, texture(uPositionTexture, vTexCoord).x * float(uIteration) / 2048.0
-        )),
+		vec3(texture(uColorTexture, mod(shade, 2048.0) / 2048.0)),
         1.0
 	);
 }
@@ -0,0 +1,73 @@
+#version 430 core
+
+// Escape statistics of mandelbrot_cs.glsl's image for the automatic iteration, as EscapeStats in
+// src/fractal_escape_stats.h. Each workgroup counts in shared memory, then adds its counts to the
+// buffer with one atomic per bin.
+
+layout(local_size_x = 32, local_size_y = 32) in;
+
+layout(r32ui) readonly uniform uimage2D uImage;     // Escape iteration, 0 if still inside
+uniform ivec2 uImageDim;
+uniform int uIteration;
+
+layout(std430, binding = 0) buffer Stats
+{
+	uint inside;        // Also at or above uIteration
+	uint late;          // Escaped in the upper half of uIteration
+	uint maxEscape;
+	uint padding;
+	uint histogram[32]; // Escapes in [2^i, 2^(i + 1))
+};
+
+shared uint sInside;
+shared uint sLate;
+shared uint sMaxEscape;
+shared uint sHistogram[32];
+
+void main() {
+	uint local = gl_LocalInvocationIndex;
+	if (local < 32u)
+	{
+		sHistogram[local] = 0u;
+	}
+	if (local == 0u)
+	{
+		sInside = 0u;
+		sLate = 0u;
+		sMaxEscape = 0u;
+	}
+	memoryBarrierShared();
+	barrier();
+
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if (all(lessThan(pixel, uImageDim)))
+	{
+		uint it = imageLoad(uImage, pixel).x;
+		if (it == 0u || it >= uint(uIteration))
+		{
+			atomicAdd(sInside, 1u);
+		}
+		else
+		{
+			atomicAdd(sHistogram[findMSB(it)], 1u);
+			atomicMax(sMaxEscape, it);
+			if (2u * it >= uint(uIteration))
+			{
+				atomicAdd(sLate, 1u);
+			}
+		}
+	}
+	memoryBarrierShared();
+	barrier();
+
+	if (local < 32u && sHistogram[local] != 0u)
+	{
+		atomicAdd(histogram[local], sHistogram[local]);
+	}
+	if (local == 0u)
+	{
+		atomicAdd(inside, sInside);
+		atomicAdd(late, sLate);
+		atomicMax(maxEscape, sMaxEscape);
+	}
+}
@@ -2,20 +2,97 @@
 
 layout(local_size_x = 32, local_size_y = 32) in;
 
-layout(r8) uniform image2D uImage;
+layout(r32ui) uniform uimage2D uImage;  // Escape iteration, 0 if still inside at uIteration
 uniform vec4 uRangeRect;
 uniform vec2 uImageDim;
 uniform int uIteration;
+uniform ivec2 uPixelOffset;    // Of the dispatched region, when only part of the image is recomputed
+
+// Progressive refinement: every uStride-th pixel of the region, each also filling the uStride square
+// it stands for until a finer pass gets there. 1 computes every pixel. With uSkipCoarser, pixels on
+// the grid of the pass before, twice as coarse, are left as they are.
+uniform int uStride;
+uniform bool uSkipCoarser;
+
+// Optional state to continue from when only uIteration grows: z as raw bits, the iteration reached
+// being in uImage already, with 0 standing for uLastIteration
+layout(rgba32ui) uniform uimage2D uStateZ;
+uniform bool uKeepState;
+uniform bool uResume;
+uniform int uLastIteration;
+
+// Optional fractional escape time, for coloring without bands
+layout(r32f) uniform image2D uSmooth;
+uniform bool uWriteSmooth;
+
+// Optional interior checks, as in src/fractal_kernel.h: the main cardioid and the period 2 bulb
+// in closed form, then the orbit compared against the point it reached at the last power of two
+// steps, since coming back to it means a cycle that never escapes
+uniform bool uInteriorChecks;
+
+const float PERIOD_EPSILON = 1e-6;
+
+bool inMainComponents(vec2 c)
+{
+	float x = c.x - 0.25;
+	float y2 = c.y * c.y;
+	float q = x * x + y2;
+	if (q * (q + x) <= 0.25 * y2)
+	{
+		return true;
+	}
+	return (c.x + 1.0) * (c.x + 1.0) + y2 <= 0.0625;
+}
 
 void main() {
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy) * uStride + uPixelOffset;
+	if (uSkipCoarser && all(equal((pixel - uPixelOffset) % (2 * uStride), ivec2(0))))
+	{
+		return;
+	}
 	vec2 z = vec2(0.0, 0.0);
-	vec2 c = vec2(uRangeRect.xy) + vec2(uRangeRect.zw) * vec2(gl_GlobalInvocationID.xy) / uImageDim;
+	vec2 c = vec2(uRangeRect.xy) + vec2(uRangeRect.zw) * vec2(pixel) / uImageDim;
 
 	uint it = 0;
+	if (uResume)
+	{
+		z = uintBitsToFloat(imageLoad(uStateZ, pixel).xy);
+		it = imageLoad(uImage, pixel).x;
+		if (it == 0u)
+		{
+			it = uint(uLastIteration);
+		}
+	}
+	if (uInteriorChecks && inMainComponents(c))
+	{
+		it = uint(uIteration);
+	}
+
+	vec2 saved = z;
+	uint steps = 0u;
 	for (; it < uIteration && (z.x * z.x + z.y * z.y < 2.0 * 2.0); it++)
 	{
 		z += c;
 		z = vec2(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y);
+
+		if (uInteriorChecks)
+		{
+			if (all(lessThan(abs(z - saved), vec2(PERIOD_EPSILON))))
+			{
+				it = uint(uIteration);
+				break;
+			}
+			if ((steps & (steps + 1u)) == 0u)
+			{
+				saved = z;
+			}
+			steps++;
+		}
+	}
+
+	if (uKeepState)
+	{
+		imageStore(uStateZ, pixel, uvec4(floatBitsToUint(z), 0u, 0u));
 	}
 
     if (it == uIteration)
@@ -23,7 +100,26 @@ void main() {
         it = 0;
     }
 
-	imageStore(uImage, ivec2(gl_GlobalInvocationID.xy), vec4(float(it) / float(uIteration), 0.0, 0.0, 0.0));
+	float smoothIt = 0.0;
+	if (uWriteSmooth && it != 0u)
+	{
+		// Escaped at |z| >= 2, so log2(|z|) >= 1
+		float magnitude = z.x * z.x + z.y * z.y;
+		smoothIt = float(it) + 1.0 - log2(0.5 * log2(magnitude));
+	}
+
+	for (int i = 0; i < uStride * uStride; i++)
+	{
+		ivec2 fill = pixel + ivec2(i % uStride, i / uStride);
+		if (all(lessThan(fill, ivec2(uImageDim))))
+		{
+			if (uWriteSmooth)
+			{
+				imageStore(uSmooth, fill, vec4(smoothIt, 0.0, 0.0, 0.0));
+			}
+			imageStore(uImage, fill, uvec4(it));
+		}
+	}
 }
 
 
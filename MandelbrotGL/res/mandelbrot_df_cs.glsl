@@ -0,0 +1,209 @@
+#version 430 core
+
+// Same kernel as mandelbrot_cs.glsl, with every coordinate held as an unevaluated sum
+// of two floats (hi, lo) for about 48 bits of mantissa.
+// "precise" keeps the compiler from folding away the rounding error terms.
+
+layout(local_size_x = 32, local_size_y = 32) in;
+
+layout(r32ui) uniform uimage2D uImage;  // Escape iteration, 0 if still inside at uIteration
+uniform vec4 uRangeRectHi;  // uRangeRect split by the host into hi + lo
+uniform vec4 uRangeRectLo;
+uniform vec2 uImageDim;
+uniform int uIteration;
+uniform ivec2 uPixelOffset;    // Of the dispatched region, when only part of the image is recomputed
+
+// Progressive refinement: every uStride-th pixel of the region, each also filling the uStride square
+// it stands for until a finer pass gets there. 1 computes every pixel. With uSkipCoarser, pixels on
+// the grid of the pass before, twice as coarse, are left as they are.
+uniform int uStride;
+uniform bool uSkipCoarser;
+
+// Optional state to continue from when only uIteration grows: z as raw bits, the iteration reached
+// being in uImage already, with 0 standing for uLastIteration
+layout(rgba32ui) uniform uimage2D uStateZ;
+uniform bool uKeepState;
+uniform bool uResume;
+uniform int uLastIteration;
+
+// Optional fractional escape time, for coloring without bands
+layout(r32f) uniform image2D uSmooth;
+uniform bool uWriteSmooth;
+
+// Optional interior checks, as in mandelbrot_cs.glsl. Orbit points are compared by |hi| + |lo| of
+// their difference, which never underestimates it, so a cycle is only missed, never made up.
+uniform bool uInteriorChecks;
+
+const float PERIOD_EPSILON = 1e-12;
+
+// Error free transformations
+
+vec2 quickTwoSum(float a, float b)  // Needs |a| >= |b|
+{
+	precise float s = a + b;
+	precise float e = b - (s - a);
+	return vec2(s, e);
+}
+
+vec2 twoSum(float a, float b)
+{
+	precise float s = a + b;
+	precise float v = s - a;
+	precise float e = (a - (s - v)) + (b - v);
+	return vec2(s, e);
+}
+
+vec2 twoProd(float a, float b)
+{
+	precise float p = a * b;
+	precise float e = fma(a, b, -p);
+	return vec2(p, e);
+}
+
+// Double-float arithmetic, x is hi and y is lo
+
+vec2 dfAdd(vec2 a, vec2 b)
+{
+	precise vec2 s = twoSum(a.x, b.x);
+	precise vec2 t = twoSum(a.y, b.y);
+	s.y += t.x;
+	s = quickTwoSum(s.x, s.y);
+	s.y += t.y;
+	return quickTwoSum(s.x, s.y);
+}
+
+vec2 dfSub(vec2 a, vec2 b)
+{
+	return dfAdd(a, -b);
+}
+
+vec2 dfMul(vec2 a, vec2 b)
+{
+	precise vec2 p = twoProd(a.x, b.x);
+	p.y += a.x * b.y + a.y * b.x;
+	return quickTwoSum(p.x, p.y);
+}
+
+vec2 dfMulFloat(vec2 a, float b)
+{
+	precise vec2 p = twoProd(a.x, b);
+	p.y += a.y * b;
+	return quickTwoSum(p.x, p.y);
+}
+
+vec2 dfDivFloat(vec2 a, float b)
+{
+	precise float q1 = a.x / b;
+	precise vec2 r = dfSub(a, twoProd(q1, b));
+	precise float q2 = r.x / b;
+	return quickTwoSum(q1, q2);
+}
+
+bool inMainComponents(vec2 cx, vec2 cy)
+{
+	vec2 x = dfSub(cx, vec2(0.25, 0.0));
+	vec2 y2 = dfMul(cy, cy);
+	vec2 q = dfAdd(dfMul(x, x), y2);
+	if (dfSub(dfMul(q, dfAdd(q, x)), dfMulFloat(y2, 0.25)).x <= 0.0)
+	{
+		return true;
+	}
+	vec2 bx = dfAdd(cx, vec2(1.0, 0.0));
+	return dfSub(dfAdd(dfMul(bx, bx), y2), vec2(0.0625, 0.0)).x <= 0.0;
+}
+
+bool dfNear(vec2 a, vec2 b)
+{
+	vec2 difference = abs(a - b);
+	return difference.x + difference.y < PERIOD_EPSILON;
+}
+
+void main() {
+	ivec2 pixelIndex = ivec2(gl_GlobalInvocationID.xy) * uStride + uPixelOffset;
+	if (uSkipCoarser && all(equal((pixelIndex - uPixelOffset) % (2 * uStride), ivec2(0))))
+	{
+		return;
+	}
+	vec2 pixel = vec2(pixelIndex);
+	vec2 cx = dfAdd(vec2(uRangeRectHi.x, uRangeRectLo.x), dfDivFloat(dfMulFloat(vec2(uRangeRectHi.z, uRangeRectLo.z), pixel.x), uImageDim.x));
+	vec2 cy = dfAdd(vec2(uRangeRectHi.y, uRangeRectLo.y), dfDivFloat(dfMulFloat(vec2(uRangeRectHi.w, uRangeRectLo.w), pixel.y), uImageDim.y));
+
+	vec2 zx = vec2(0.0);
+	vec2 zy = vec2(0.0);
+
+	uint it = 0;
+	if (uResume)
+	{
+		vec4 state = uintBitsToFloat(imageLoad(uStateZ, pixelIndex));
+		zx = state.xy;
+		zy = state.zw;
+		it = imageLoad(uImage, pixelIndex).x;
+		if (it == 0u)
+		{
+			it = uint(uLastIteration);
+		}
+	}
+	if (uInteriorChecks && inMainComponents(cx, cy))
+	{
+		it = uint(uIteration);
+	}
+
+	vec2 savedX = zx;
+	vec2 savedY = zy;
+	uint steps = 0u;
+	for (; it < uIteration && (zx.x * zx.x + zy.x * zy.x < 2.0 * 2.0); it++)
+	{
+		zx = dfAdd(zx, cx);
+		zy = dfAdd(zy, cy);
+
+		vec2 x = dfSub(dfMul(zx, zx), dfMul(zy, zy));
+		zy = dfMulFloat(dfMul(zx, zy), 2.0);
+		zx = x;
+
+		if (uInteriorChecks)
+		{
+			if (dfNear(zx, savedX) && dfNear(zy, savedY))
+			{
+				it = uint(uIteration);
+				break;
+			}
+			if ((steps & (steps + 1u)) == 0u)
+			{
+				savedX = zx;
+				savedY = zy;
+			}
+			steps++;
+		}
+	}
+
+	if (uKeepState)
+	{
+		imageStore(uStateZ, pixelIndex, floatBitsToUint(vec4(zx, zy)));
+	}
+
+    if (it == uIteration)
+    {
+        it = 0;
+    }
+
+	float smoothIt = 0.0;
+	if (uWriteSmooth && it != 0u)
+	{
+		// Escaped at |z| >= 2, so log2(|z|) >= 1
+		float magnitude = zx.x * zx.x + zy.x * zy.x;
+		smoothIt = float(it) + 1.0 - log2(0.5 * log2(magnitude));
+	}
+
+	for (int i = 0; i < uStride * uStride; i++)
+	{
+		ivec2 fill = pixelIndex + ivec2(i % uStride, i / uStride);
+		if (all(lessThan(fill, ivec2(uImageDim))))
+		{
+			if (uWriteSmooth)
+			{
+				imageStore(uSmooth, fill, vec4(smoothIt, 0.0, 0.0, 0.0));
+			}
+			imageStore(uImage, fill, uvec4(it));
+		}
+	}
+}
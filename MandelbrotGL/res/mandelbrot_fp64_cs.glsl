@@ -0,0 +1,125 @@
+#version 430 core
+#extension GL_ARB_gpu_shader_fp64 : enable
+
+layout(local_size_x = 32, local_size_y = 32) in;
+
+layout(r32ui) uniform uimage2D uImage;  // Escape iteration, 0 if still inside at uIteration
+uniform dvec4 uRangeRect;
+uniform vec2 uImageDim;
+uniform int uIteration;
+uniform ivec2 uPixelOffset;    // Of the dispatched region, when only part of the image is recomputed
+
+// Progressive refinement: every uStride-th pixel of the region, each also filling the uStride square
+// it stands for until a finer pass gets there. 1 computes every pixel. With uSkipCoarser, pixels on
+// the grid of the pass before, twice as coarse, are left as they are.
+uniform int uStride;
+uniform bool uSkipCoarser;
+
+// Optional state to continue from when only uIteration grows: z as raw bits, the iteration reached
+// being in uImage already, with 0 standing for uLastIteration
+layout(rgba32ui) uniform uimage2D uStateZ;
+uniform bool uKeepState;
+uniform bool uResume;
+uniform int uLastIteration;
+
+// Optional fractional escape time, for coloring without bands
+layout(r32f) uniform image2D uSmooth;
+uniform bool uWriteSmooth;
+
+// Optional interior checks, as in src/fractal_kernel.h: the main cardioid and the period 2 bulb
+// in closed form, then the orbit compared against the point it reached at the last power of two
+// steps, since coming back to it means a cycle that never escapes
+uniform bool uInteriorChecks;
+
+const double PERIOD_EPSILON = 1e-12LF;
+
+bool inMainComponents(dvec2 c)
+{
+	double x = c.x - 0.25LF;
+	double y2 = c.y * c.y;
+	double q = x * x + y2;
+	if (q * (q + x) <= 0.25LF * y2)
+	{
+		return true;
+	}
+	return (c.x + 1.0LF) * (c.x + 1.0LF) + y2 <= 0.0625LF;
+}
+
+void main() {
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy) * uStride + uPixelOffset;
+	if (uSkipCoarser && all(equal((pixel - uPixelOffset) % (2 * uStride), ivec2(0))))
+	{
+		return;
+	}
+	dvec2 z = dvec2(0.0, 0.0);
+	dvec2 c = uRangeRect.xy + uRangeRect.zw * dvec2(pixel) / dvec2(uImageDim);
+
+	uint it = 0;
+	if (uResume)
+	{
+		uvec4 state = imageLoad(uStateZ, pixel);
+		z = dvec2(packDouble2x32(state.xy), packDouble2x32(state.zw));
+		it = imageLoad(uImage, pixel).x;
+		if (it == 0u)
+		{
+			it = uint(uLastIteration);
+		}
+	}
+	if (uInteriorChecks && inMainComponents(c))
+	{
+		it = uint(uIteration);
+	}
+
+	dvec2 saved = z;
+	uint steps = 0u;
+	for (; it < uIteration && (z.x * z.x + z.y * z.y < 2.0LF * 2.0LF); it++)
+	{
+		z += c;
+		z = dvec2(z.x * z.x - z.y * z.y, 2.0LF * z.x * z.y);
+
+		if (uInteriorChecks)
+		{
+			if (all(lessThan(abs(z - saved), dvec2(PERIOD_EPSILON))))
+			{
+				it = uint(uIteration);
+				break;
+			}
+			if ((steps & (steps + 1u)) == 0u)
+			{
+				saved = z;
+			}
+			steps++;
+		}
+	}
+
+	if (uKeepState)
+	{
+		imageStore(uStateZ, pixel, uvec4(unpackDouble2x32(z.x), unpackDouble2x32(z.y)));
+	}
+
+    if (it == uIteration)
+    {
+        it = 0;
+    }
+
+	float smoothIt = 0.0;
+	if (uWriteSmooth && it != 0u)
+	{
+		// Escaped at |z| >= 2, so log2(|z|) >= 1
+		float magnitude = float(z.x * z.x + z.y * z.y);
+		smoothIt = float(it) + 1.0 - log2(0.5 * log2(magnitude));
+	}
+
+	for (int i = 0; i < uStride * uStride; i++)
+	{
+		ivec2 fill = pixel + ivec2(i % uStride, i / uStride);
+		if (all(lessThan(fill, ivec2(uImageDim))))
+		{
+			if (uWriteSmooth)
+			{
+				imageStore(uSmooth, fill, vec4(smoothIt, 0.0, 0.0, 0.0));
+			}
+			imageStore(uImage, fill, uvec4(it));
+		}
+	}
+}
@@ -0,0 +1,114 @@
+#version 430 core
+#extension GL_ARB_gpu_shader_fp64 : enable
+
+// Deep zoom: every pixel iterates only its difference dz from a reference orbit Z
+// computed by the host in high precision, dz <- 2 Z dz + dz^2 + dc.
+// The "z += c; z = z * z" loop of mandelbrot_cs.glsl tests the orbit Z(n + 1) = Z(n)^2 + c
+// against |Z(n)|^2 < 2, so the result matches it.
+//
+// Iterations before uSkipIteration are replaced by the host's series approximation,
+// dz = A dc + B dc^2 + C dc^3.
+
+layout(local_size_x = 32, local_size_y = 32) in;
+
+layout(r32ui) uniform uimage2D uImage;  // Escape iteration, 0 if still inside at uIteration
+layout(r8ui) uniform uimage2D uGlitchMask;
+
+layout(std430, binding = 0) readonly buffer ReferenceOrbit
+{
+	dvec2 uOrbit[];
+};
+
+layout(std430, binding = 1) buffer GlitchInfo
+{
+	uint uGlitchCount;
+	uint uGlitchPixel;      // y * width + x of a glitched pixel with about the lowest rank, the next reference
+	uint uGlitchRank;       // Precision glitches first, then the pixels nearest 0 when the reference escaped
+};
+
+uniform dvec4 uDeltaRect;   // Like uRangeRect, relative to the reference point
+uniform vec2 uImageDim;
+uniform int uIteration;
+uniform int uOrbitLength;
+uniform bool uGlitchedOnly; // Only redo what the previous reference glitched on
+uniform bool uDetectGlitch;
+uniform int uSkipIteration;
+uniform dvec2 uSeriesA;
+uniform dvec2 uSeriesB;
+uniform dvec2 uSeriesC;
+
+const double GLITCH_TOLERANCE = 1e-6LF;    // On |Z + dz|^2 / |Z|^2
+
+dvec2 complexMultiply(dvec2 a, dvec2 b)
+{
+	return dvec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+}
+
+void main() {
+	ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+	if (pixel.x >= int(uImageDim.x) || pixel.y >= int(uImageDim.y))
+	{
+		return;
+	}
+	if (uGlitchedOnly && imageLoad(uGlitchMask, pixel).x == 0u)
+	{
+		return;
+	}
+
+	dvec2 dc = uDeltaRect.xy + uDeltaRect.zw * dvec2(pixel) / dvec2(uImageDim);
+	dvec2 dc2 = complexMultiply(dc, dc);
+	dvec2 dz = complexMultiply(uSeriesA, dc) + complexMultiply(uSeriesB, dc2) + complexMultiply(uSeriesC, complexMultiply(dc2, dc));
+
+	uint it = uint(uSkipIteration);
+	bool glitched = false;
+	uint rank = 0u;
+	double magnitude = 0.0LF;
+	for (; it < uIteration; it++)
+	{
+		if (it >= uint(uOrbitLength))
+		{
+			glitched = uDetectGlitch;   // The reference escaped first
+			rank = 0x80000000u + uint(magnitude * 536870912.0LF);   // |z|^2 < 2 keeps it below 2^31 more
+			break;
+		}
+
+		dvec2 Z = uOrbit[it];
+		dvec2 z = Z + dz;
+		magnitude = z.x * z.x + z.y * z.y;
+		if (magnitude >= 2.0LF)
+		{
+			break;
+		}
+		if (uDetectGlitch && magnitude < GLITCH_TOLERANCE * (Z.x * Z.x + Z.y * Z.y))
+		{
+			glitched = true;
+			rank = uint(magnitude / ((Z.x * Z.x + Z.y * Z.y) * GLITCH_TOLERANCE) * 2147483647.0LF);
+			break;
+		}
+
+		dz = dvec2(
+			2.0LF * (Z.x * dz.x - Z.y * dz.y) + (dz.x * dz.x - dz.y * dz.y),
+			2.0LF * (Z.x * dz.y + Z.y * dz.x) + 2.0LF * dz.x * dz.y
+		) + dc;
+	}
+
+    if (it == uIteration)
+    {
+        it = 0;
+    }
+
+	imageStore(uGlitchMask, pixel, uvec4(glitched ? 1u : 0u));
+	if (glitched)
+	{
+		atomicAdd(uGlitchCount, 1u);
+
+		// Not atomic as a pair, a pixel that was the lowest when it checked may still overwrite a lower one
+		if (rank < atomicMin(uGlitchRank, rank))
+		{
+			atomicExchange(uGlitchPixel, uint(pixel.y) * uint(uImageDim.x) + uint(pixel.x));
+		}
+	}
+
+	// A glitched pixel still gets its best guess, until a later reference fixes it
+	imageStore(uImage, pixel, uvec4(it));
+}
@@ -0,0 +1,209 @@
+#version 430 core
+
+// Mariani-Silver subdivision of mandelbrot_cs.glsl's image: a rectangle whose border all escapes at
+// the same iteration is filled with it, as the set and its escape bands have no holes; any other is
+// cut in four through its middle row and column. One workgroup per rectangle. Each pass computes the
+// middle lines of the rectangles the pass before appended to the worklist, and appends their quarters.
+
+layout(local_size_x = 64) in;
+
+layout(r32ui) uniform uimage2D uImage;  // Escape iteration, 0 if still inside at uIteration
+uniform vec4 uRangeRect;
+uniform vec2 uImageDim;
+uniform int uIteration;
+
+// Optional fractional escape time. Only rectangles inside the set are filled then, the others have
+// no single value to fill with.
+layout(r32f) uniform image2D uSmooth;
+uniform bool uWriteSmooth;
+
+// Optional interior checks, as in mandelbrot_cs.glsl: the main cardioid and the period 2 bulb
+// in closed form, then periodicity checking
+uniform bool uInteriorChecks;
+
+const float PERIOD_EPSILON = 1e-6;
+
+bool inMainComponents(vec2 c)
+{
+	float x = c.x - 0.25;
+	float y2 = c.y * c.y;
+	float q = x * x + y2;
+	if (q * (q + x) <= 0.25 * y2)
+	{
+		return true;
+	}
+	return (c.x + 1.0) * (c.x + 1.0) + y2 <= 0.0625;
+}
+
+// Rectangles as inclusive pixel corners (x0, y0, x1, y1), their border already in uImage.
+// The header is the workgroup count of the pass over them, then the pixels that pass computed.
+layout(std430, binding = 0) buffer InputList
+{
+	uvec4 inHeader;
+	ivec4 inRects[];
+};
+layout(std430, binding = 1) buffer OutputList
+{
+	uvec4 outHeader;
+	ivec4 outRects[];
+};
+
+uniform bool uInitial;      // First pass: squares of uInitialSize over the image, border not computed
+uniform int uInitialSize;
+uniform bool uSplit;        // False on the last pass, which computes whatever isn't uniform
+uniform int uLeafSize;      // Computed rather than cut at or below this size
+
+shared uint sMin;
+shared uint sMax;
+shared uint sComputed;
+
+uint computePixel(ivec2 pixel)
+{
+	vec2 z = vec2(0.0, 0.0);
+	vec2 c = vec2(uRangeRect.xy) + vec2(uRangeRect.zw) * vec2(pixel) / uImageDim;
+
+	uint it = 0;
+	if (uInteriorChecks && inMainComponents(c))
+	{
+		it = uint(uIteration);
+	}
+
+	vec2 saved = z;
+	uint steps = 0u;
+	for (; it < uIteration && (z.x * z.x + z.y * z.y < 2.0 * 2.0); it++)
+	{
+		z += c;
+		z = vec2(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y);
+
+		if (uInteriorChecks)
+		{
+			if (all(lessThan(abs(z - saved), vec2(PERIOD_EPSILON))))
+			{
+				it = uint(uIteration);
+				break;
+			}
+			if ((steps & (steps + 1u)) == 0u)
+			{
+				saved = z;
+			}
+			steps++;
+		}
+	}
+
+	if (it == uIteration)
+	{
+		it = 0;
+	}
+
+	if (uWriteSmooth)
+	{
+		float magnitude = z.x * z.x + z.y * z.y;
+		float smoothIt = (it == 0u) ? 0.0 : float(it) + 1.0 - log2(0.5 * log2(magnitude));
+		imageStore(uSmooth, pixel, vec4(smoothIt, 0.0, 0.0, 0.0));
+	}
+
+	imageStore(uImage, pixel, uvec4(it));
+	atomicAdd(sComputed, 1u);
+	return it;
+}
+
+// Counterclockwise from the bottom left corner, each pixel once
+ivec2 borderPixel(ivec4 rect, ivec2 size, int i)
+{
+	if (i < size.x) return ivec2(rect.x + i, rect.y);
+	i -= size.x;
+	if (i < size.y) return ivec2(rect.z, rect.y + i);
+	i -= size.y;
+	if (i < size.x) return ivec2(rect.z - i, rect.w);
+	i -= size.x;
+	return ivec2(rect.x, rect.w - i);
+}
+
+void main() {
+	int local = int(gl_LocalInvocationIndex);
+	int groupSize = int(gl_WorkGroupSize.x);
+
+	ivec4 rect;
+	if (uInitial)
+	{
+		ivec2 corner = ivec2(gl_WorkGroupID.xy) * uInitialSize;
+		rect = ivec4(corner, min(corner + uInitialSize, ivec2(uImageDim) - 1));
+	}
+	else
+	{
+		rect = inRects[gl_WorkGroupID.x];
+	}
+	ivec2 size = rect.zw - rect.xy;
+	ivec2 inner = max(size - 1, ivec2(0));
+
+	if (local == 0)
+	{
+		sMin = 0xFFFFFFFFu;
+		sMax = 0u;
+		sComputed = 0u;
+	}
+	memoryBarrierShared();
+	barrier();
+
+	int perimeter = max(2 * (size.x + size.y), 1);
+	for (int i = local; i < perimeter; i += groupSize)
+	{
+		ivec2 pixel = borderPixel(rect, size, i);
+		uint it = uInitial ? computePixel(pixel) : imageLoad(uImage, pixel).x;
+		atomicMin(sMin, it);
+		atomicMax(sMax, it);
+	}
+	memoryBarrierShared();
+	barrier();
+
+	bool uniformBorder = (sMin == sMax) && (uWriteSmooth == false || sMin == 0u);
+	if (uniformBorder)
+	{
+		for (int i = local; i < inner.x * inner.y; i += groupSize)
+		{
+			ivec2 pixel = rect.xy + 1 + ivec2(i % inner.x, i / inner.x);
+			imageStore(uImage, pixel, uvec4(sMin));
+			if (uWriteSmooth)
+			{
+				imageStore(uSmooth, pixel, vec4(0.0));
+			}
+		}
+	}
+	else if (uSplit == false || size.x <= uLeafSize || size.y <= uLeafSize)
+	{
+		for (int i = local; i < inner.x * inner.y; i += groupSize)
+		{
+			computePixel(rect.xy + 1 + ivec2(i % inner.x, i / inner.x));
+		}
+	}
+	else
+	{
+		// Middle column, then the middle row but where it crosses the column
+		ivec2 middle = (rect.xy + rect.zw) / 2;
+		for (int i = local; i < inner.y + inner.x - 1; i += groupSize)
+		{
+			ivec2 pixel = (i < inner.y) ? ivec2(middle.x, rect.y + 1 + i) : ivec2(rect.x + 1 + i - inner.y, middle.y);
+			if (i >= inner.y && pixel.x >= middle.x)
+			{
+				pixel.x++;
+			}
+			computePixel(pixel);
+		}
+
+		if (local == 0)
+		{
+			uint first = atomicAdd(outHeader.x, 4u);
+			outRects[first] = ivec4(rect.xy, middle);
+			outRects[first + 1u] = ivec4(middle.x, rect.y, rect.z, middle.y);
+			outRects[first + 2u] = ivec4(rect.x, middle.y, middle.x, rect.w);
+			outRects[first + 3u] = ivec4(middle, rect.zw);
+		}
+	}
+	memoryBarrierShared();
+	barrier();
+
+	if (local == 0)
+	{
+		atomicAdd(inHeader.w, sComputed);
+	}
+}
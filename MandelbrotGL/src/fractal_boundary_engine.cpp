@@ -0,0 +1,149 @@
+#include "fractal_boundary_engine.h"
+
+#include <chrono>
+
+namespace fractal
+{
+    BoundaryTraceEngine::BoundaryTraceEngine(Precision precision, unsigned int threadCount, bool pinThreads):
+        precision(precision),
+        kernel(GetRowKernel(Isa::SCALAR, precision)),
+        scheduler(threadCount, pinThreads),
+        threads(scheduler.ThreadCount())
+    {
+        scheduler.SetTileSize({ TILE_SIZE, TILE_SIZE });
+    }
+
+    void BoundaryTraceEngine::SetPrecision(Precision precision) noexcept
+    {
+        this->precision = precision;
+        kernel = GetRowKernel(Isa::SCALAR, precision);
+    }
+
+    void BoundaryTraceEngine::Compute(const Frame& frame)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        pixelsDim = frame.imageDim;
+        pixels.resize((size_t)frame.imageDim.x * frame.imageDim.y);
+
+        const RowSpan frameSpan = {
+            frame.rangeRect.x, frame.rangeRect.y, frame.rangeRect.z, frame.rangeRect.w,
+            (double)frame.imageDim.x, (double)frame.imageDim.y,
+            0, 0,
+            1,
+            (unsigned int)frame.iteration,
+            interiorChecks
+        };
+
+        for (ThreadScratch& scratch : threads)
+        {
+            scratch.computed = 0;
+        }
+        scheduler.Run(frame.imageDim, [this, &frameSpan](const Tile& tile, unsigned int threadIndex)
+        {
+            traceTile(frameSpan, tile, threads[threadIndex]);
+        });
+
+        unsigned long long computed = 0;
+        for (const ThreadScratch& scratch : threads)
+        {
+            computed += scratch.computed;
+        }
+
+        auto end = std::chrono::steady_clock::now();
+        stats.computedFraction = (double)computed / ((double)frame.imageDim.x * frame.imageDim.y);
+        stats.computeMs = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    void BoundaryTraceEngine::traceTile(const RowSpan& frameSpan, const Tile& tile, ThreadScratch& scratch)
+    {
+        const int w = tile.w;
+        const int h = tile.h;
+        const size_t stride = (size_t)pixelsDim.x;
+        uint32_t* origin = &pixels[(size_t)tile.y * stride + tile.x];
+        std::vector<uint8_t>& state = scratch.state;
+        std::vector<int>& queue = scratch.queue;
+
+        state.assign((size_t)w * h, UNKNOWN);
+        queue.clear();
+
+        auto enqueue = [w, h, &state, &queue](int x, int y)
+        {
+            if (x >= 0 && x < w && y >= 0 && y < h && state[y * w + x] == UNKNOWN)
+            {
+                state[y * w + x] = QUEUED;
+                queue.push_back(y * w + x);
+            }
+        };
+        auto enqueueAround = [&enqueue](int x, int y)
+        {
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    enqueue(x + dx, y + dy);
+                }
+            }
+        };
+
+        // Seeds: the tile's border
+        for (int x = 0; x < w; x++)
+        {
+            enqueue(x, 0);
+            enqueue(x, h - 1);
+        }
+        for (int y = 1; y < h - 1; y++)
+        {
+            enqueue(0, y);
+            enqueue(w - 1, y);
+        }
+
+        // Last in first out, which runs along an edge before turning back
+        static const int NEIGHBOURS[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+        RowSpan span = frameSpan;
+        while (queue.empty() == false)
+        {
+            const int index = queue.back();
+            queue.pop_back();
+            const int x = index % w;
+            const int y = index / w;
+
+            uint32_t* out = origin + (size_t)y * stride + x;
+            span.x = tile.x + x;
+            span.y = tile.y + y;
+            kernel(span, out);
+            state[index] = COMPUTED;
+            scratch.computed++;
+
+            // An edge between this pixel and a computed neighbour: carry on along it on both sides
+            for (const int* offset : NEIGHBOURS)
+            {
+                const int nx = x + offset[0];
+                const int ny = y + offset[1];
+                if (nx < 0 || nx >= w || ny < 0 || ny >= h || state[ny * w + nx] != COMPUTED)
+                {
+                    continue;
+                }
+                if (origin[(size_t)ny * stride + nx] != *out)
+                {
+                    enqueueAround(x, y);
+                    enqueueAround(nx, ny);
+                }
+            }
+        }
+
+        // Every row starts on the computed border
+        for (int y = 1; y < h - 1; y++)
+        {
+            uint32_t* row = origin + (size_t)y * stride;
+            const uint8_t* rowState = &state[(size_t)y * w];
+            for (int x = 1; x < w - 1; x++)
+            {
+                if (rowState[x] != COMPUTED)
+                {
+                    row[x] = row[x - 1];
+                }
+            }
+        }
+    }
+};
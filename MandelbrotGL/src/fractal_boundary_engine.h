@@ -0,0 +1,84 @@
+#ifndef FRACTAL_BOUNDARY_ENGINE_H
+#define FRACTAL_BOUNDARY_ENGINE_H
+
+#include "fractal_engine.h"
+#include "fractal_kernel.h"
+#include "fractal_scheduler.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Boundary tracing on the CPU: only pixels along the edges between escape bands are computed,
+    // and what they enclose is filled. Each tile starts from its own border, so threads trace
+    // independently, then follows every edge it finds between two computed pixels by computing
+    // their neighbours. Pixels left over take the value of the one to their left.
+    //
+    // Same values as CpuEngine, but for bands or pieces of the set smaller than a tile that
+    // no edge leads to. Pixels are computed one at a time, by the scalar kernel.
+
+    class BoundaryTraceEngine : public FractalEngine
+    {
+    public:
+
+        struct Stats
+        {
+            double computedFraction;
+            double computeMs;
+        };
+
+        BoundaryTraceEngine(Precision precision = Precision::DOUBLE,
+            unsigned int threadCount = TileScheduler::DefaultThreadCount(), bool pinThreads = false);
+
+        const char* Name() const noexcept override { return "CPU Boundary Trace"; }
+        void Compute(const Frame& frame) override;
+
+        void SetPrecision(Precision precision) noexcept;
+        Precision GetPrecision() const noexcept { return precision; }
+
+        // Same as CpuEngine::SetInteriorChecks(), for the pixels that are computed
+        void SetInteriorChecks(bool enable) noexcept { interiorChecks = enable; }
+        bool GetInteriorChecks() const noexcept { return interiorChecks; }
+
+        // Tiles default to TILE_SIZE: smaller ones miss fewer islands, bigger ones compute fewer pixels
+        TileScheduler& Scheduler() noexcept { return scheduler; }
+
+        Stats LastStats() const noexcept { return stats; }
+
+        // Same layout and values as CpuEngine::Pixels()
+        const std::vector<uint32_t>& Pixels() const noexcept { return pixels; }
+        glm::ivec2 PixelsDim() const noexcept { return pixelsDim; }
+
+    private:
+
+        static constexpr int TILE_SIZE = 128;
+
+        enum PixelState : uint8_t
+        {
+            UNKNOWN, QUEUED, COMPUTED
+        };
+
+        // Reused from tile to tile by one thread
+        struct ThreadScratch
+        {
+            std::vector<uint8_t> state;     // PixelState of the tile's pixels
+            std::vector<int> queue;         // Pixel indices in the tile
+            unsigned long long computed = 0;
+        };
+
+        void traceTile(const RowSpan& frameSpan, const Tile& tile, ThreadScratch& scratch);
+
+        Precision precision;
+        RowKernel kernel;
+        bool interiorChecks = false;
+        TileScheduler scheduler;
+        std::vector<ThreadScratch> threads;
+        Stats stats = { 1.0, 0.0 };
+
+        std::vector<uint32_t> pixels;
+        glm::ivec2 pixelsDim = { 0, 0 };
+    };
+};
+
+#endif // FRACTAL_BOUNDARY_ENGINE_H
@@ -0,0 +1,204 @@
+#include "fractal_cpu_engine.h"
+
+#include <algorithm>
+
+namespace fractal
+{
+    CpuEngine::CpuEngine(Isa isa, Precision precision, unsigned int threadCount, bool pinThreads):
+        isa(isa),
+        precision(precision),
+        kernel(GetRowKernel(isa, precision)),
+        pixelKernel(GetRowKernel(Isa::SCALAR, precision)),
+        scheduler(threadCount, pinThreads)
+    {
+    }
+
+    void CpuEngine::SetIsa(Isa isa) noexcept
+    {
+        this->isa = isa;
+        kernel = GetRowKernel(isa, precision);
+    }
+
+    void CpuEngine::SetPrecision(Precision precision) noexcept
+    {
+        this->precision = precision;
+        kernel = GetRowKernel(isa, precision);
+        pixelKernel = GetRowKernel(Isa::SCALAR, precision);
+    }
+
+    void CpuEngine::Compute(const Frame& frame)
+    {
+        compute(frame, nullptr);
+    }
+
+    void CpuEngine::Compute(const Frame& frame, const std::vector<Tile>& regions)
+    {
+        compute(frame, &regions);
+    }
+
+    void CpuEngine::compute(const Frame& frame, const std::vector<Tile>* regions)
+    {
+        pixelsDim = frame.imageDim;
+        pixels.resize((size_t)frame.imageDim.x * frame.imageDim.y);
+
+        const RowSpan frameSpan = {
+            frame.rangeRect.x, frame.rangeRect.y, frame.rangeRect.z, frame.rangeRect.w,
+            (double)frame.imageDim.x, (double)frame.imageDim.y,
+            0, 0,
+            0,
+            (unsigned int)frame.iteration,
+            interiorChecks
+        };
+
+        computedPixels.assign(scheduler.ThreadCount(), 0);
+        const TileScheduler::TileWork work = [this, &frameSpan](const Tile& tile, unsigned int threadIndex)
+        {
+            RowSpan span = frameSpan;
+            if (subdivision == false)
+            {
+                for (int y = tile.y; y < tile.y + tile.h; y++)
+                {
+                    computeRow(span, tile.x, y, tile.w);
+                }
+                computedPixels[threadIndex] += (unsigned long long)tile.w * tile.h;
+                return;
+            }
+
+            // Border, then what it doesn't settle
+            computeRow(span, tile.x, tile.y, tile.w);
+            computeRow(span, tile.x, tile.y + tile.h - 1, (tile.h > 1) ? tile.w : 0);
+            for (int y = tile.y + 1; y < tile.y + tile.h - 1; y++)
+            {
+                computePixel(span, tile.x, y);
+                if (tile.w > 1)
+                {
+                    computePixel(span, tile.x + tile.w - 1, y);
+                }
+            }
+            unsigned long long& computed = computedPixels[threadIndex];
+            computed += (tile.h > 1 && tile.w > 1) ? 2ull * (tile.w + tile.h) - 4 : (unsigned long long)tile.w * tile.h;
+            subdivide(span, { tile.x, tile.y, tile.w, tile.h }, computed);
+        };
+
+        unsigned long long requested = (unsigned long long)frame.imageDim.x * frame.imageDim.y;
+        auto countComputed = [this, &requested]()
+        {
+            unsigned long long computed = 0;
+            for (unsigned long long count : computedPixels)
+            {
+                computed += count;
+            }
+            computedFraction = (requested > 0) ? (double)computed / requested : 1.0;
+        };
+
+        if (regions == nullptr && subdivision == false)
+        {
+            finished = scheduler.Run(frame.imageDim, work, cancel);
+            countComputed();
+            return;
+        }
+
+        // Each region split like a whole frame, so threads still share big ones
+        const std::vector<Tile> wholeFrame = { { 0, 0, frame.imageDim.x, frame.imageDim.y } };
+        const glm::ivec2 tileSize = (subdivision) ? glm::max(scheduler.GetTileSize(), SUBDIVISION_TILE) : scheduler.GetTileSize();
+        std::vector<Tile> tiles;
+        requested = 0;
+        for (const Tile& region : (regions) ? *regions : wholeFrame)
+        {
+            requested += (unsigned long long)region.w * region.h;
+            for (int y = region.y; y < region.y + region.h; y += tileSize.y)
+            {
+                for (int x = region.x; x < region.x + region.w; x += tileSize.x)
+                {
+                    tiles.push_back({ x, y, glm::min(tileSize.x, region.x + region.w - x), glm::min(tileSize.y, region.y + region.h - y) });
+                }
+            }
+        }
+        finished = scheduler.Run(tiles, work, cancel);
+        countComputed();
+    }
+
+    // Kernels write escape iterations straight into the image rows
+
+    void CpuEngine::computeRow(RowSpan& span, int x, int y, int count)
+    {
+        if (count > 0)
+        {
+            span.x = x;
+            span.y = y;
+            span.count = count;
+            kernel(span, &pixels[(size_t)y * pixelsDim.x + x]);
+        }
+    }
+
+    void CpuEngine::computePixel(RowSpan& span, int x, int y)
+    {
+        span.x = x;
+        span.y = y;
+        span.count = 1;
+        pixelKernel(span, &pixels[(size_t)y * pixelsDim.x + x]);
+    }
+
+    // Mariani-Silver, rect's border being computed already. Quarters share their edges.
+
+    void CpuEngine::subdivide(RowSpan& span, const Recti& rect, unsigned long long& computed)
+    {
+        const int innerW = rect.w - 2;
+        const int innerH = rect.h - 2;
+        if (innerW <= 0 || innerH <= 0)
+        {
+            return;
+        }
+
+        const size_t stride = (size_t)pixelsDim.x;
+        uint32_t* corner = &pixels[(size_t)rect.y * stride + rect.x];
+        const uint32_t value = corner[0];
+        const uint32_t* top = corner + (size_t)(rect.h - 1) * stride;
+        bool uniform = true;
+        for (int x = 0; x < rect.w && uniform; x++)
+        {
+            uniform = (corner[x] == value) && (top[x] == value);
+        }
+        for (int y = 1; y < rect.h - 1 && uniform; y++)
+        {
+            uniform = (corner[y * stride] == value) && (corner[y * stride + rect.w - 1] == value);
+        }
+
+        if (uniform)
+        {
+            for (int y = 1; y <= innerH; y++)
+            {
+                std::fill_n(corner + y * stride + 1, innerW, value);
+            }
+            return;
+        }
+
+        if (rect.w <= SUBDIVISION_LEAF || rect.h <= SUBDIVISION_LEAF)
+        {
+            for (int y = 1; y <= innerH; y++)
+            {
+                computeRow(span, rect.x + 1, rect.y + y, innerW);
+            }
+            computed += (unsigned long long)innerW * innerH;
+            return;
+        }
+
+        // Middle row, then the middle column above and below it
+        const int middleX = rect.w / 2;
+        const int middleY = rect.h / 2;
+        computeRow(span, rect.x + 1, rect.y + middleY, innerW);
+        for (int y = 1; y <= innerH; y++)
+        {
+            if (y != middleY)
+            {
+                computePixel(span, rect.x + middleX, rect.y + y);
+            }
+        }
+        computed += (unsigned long long)innerW + innerH - 1;
+
+        subdivide(span, { rect.x, rect.y, middleX + 1, middleY + 1 }, computed);
+        subdivide(span, { rect.x + middleX, rect.y, rect.w - middleX, middleY + 1 }, computed);
+        subdivide(span, { rect.x, rect.y + middleY, middleX + 1, rect.h - middleY }, computed);
+        subdivide(span, { rect.x + middleX, rect.y + middleY, rect.w - middleX, rect.h - middleY }, computed);
+    }
+};
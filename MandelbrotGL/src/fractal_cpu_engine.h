@@ -0,0 +1,88 @@
+#ifndef FRACTAL_CPU_ENGINE_H
+#define FRACTAL_CPU_ENGINE_H
+
+#include "fractal_engine.h"
+#include "fractal_kernel.h"
+#include "fractal_rect.h"
+#include "fractal_scheduler.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Computes on the CPU what res/mandelbrot_cs.glsl stores into its r32ui image.
+    // Isa::SCALAR with Precision::FLOAT is the reference every other engine is checked against;
+    // the SIMD kernels give the same result as long as the compiler doesn't contract mul + add.
+    //
+    // With subdivision on, each tile is computed Mariani-Silver style: its border first, then a
+    // rectangle whose border escapes at one iteration is filled with it, any other cut in four
+    // through its middle row and column. Filaments thinner than a pixel can slip through borders.
+
+    class CpuEngine : public FractalEngine
+    {
+    public:
+
+        CpuEngine(Isa isa = DetectIsa(), Precision precision = Precision::FLOAT,
+            unsigned int threadCount = TileScheduler::DefaultThreadCount(), bool pinThreads = false);
+
+        const char* Name() const noexcept override { return "CPU"; }
+        void Compute(const Frame& frame) override;
+
+        // Only the pixels of regions, the others keep what they had if the size didn't change
+        void Compute(const Frame& frame, const std::vector<Tile>& regions);
+
+        void SetIsa(Isa isa) noexcept;
+        Isa GetIsa() const noexcept { return isa; }
+        void SetPrecision(Precision precision) noexcept;
+        Precision GetPrecision() const noexcept { return precision; }
+
+        TileScheduler& Scheduler() noexcept { return scheduler; }
+
+        // Cardioid and bulb test, then periodicity checking, in every kernel
+        void SetInteriorChecks(bool enable) noexcept { interiorChecks = enable; }
+        bool GetInteriorChecks() const noexcept { return interiorChecks; }
+
+        // Tiles are SUBDIVISION_TILE a side at least then, to leave it big rectangles to fill
+        void SetSubdivision(bool enable) noexcept { subdivision = enable; }
+        bool GetSubdivision() const noexcept { return subdivision; }
+        double LastComputedFraction() const noexcept { return computedFraction; }   // Of the pixels asked for
+
+        // Checked between tiles; a cancelled frame leaves the pixels partially updated
+        void SetCancelToken(const CancelToken* token) noexcept { cancel = token; }
+        bool LastComputeFinished() const noexcept { return finished; }
+
+        // Row major, bottom row first, same layout as the texture
+        const std::vector<uint32_t>& Pixels() const noexcept { return pixels; }
+        glm::ivec2 PixelsDim() const noexcept { return pixelsDim; }
+
+    private:
+
+        static constexpr int SUBDIVISION_TILE = 128;
+        static constexpr int SUBDIVISION_LEAF = 8;     // Computed rather than cut at or below this size
+
+        void compute(const Frame& frame, const std::vector<Tile>* regions);
+        void computeRow(RowSpan& span, int x, int y, int count);
+        void computePixel(RowSpan& span, int x, int y);
+        void subdivide(RowSpan& span, const Recti& rect, unsigned long long& computed);
+
+        Isa isa;
+        Precision precision;
+        RowKernel kernel;
+        RowKernel pixelKernel;      // Scalar, for lone pixels the SIMD lanes would pad with others
+        bool interiorChecks = false;
+
+        TileScheduler scheduler;
+        const CancelToken* cancel = nullptr;
+        bool finished = true;
+
+        bool subdivision = false;
+        double computedFraction = 1.0;
+        std::vector<unsigned long long> computedPixels;    // Per thread
+
+        std::vector<uint32_t> pixels;
+        glm::ivec2 pixelsDim = { 0, 0 };
+    };
+};
+
+#endif // FRACTAL_CPU_ENGINE_H
@@ -0,0 +1,134 @@
+#ifndef FRACTAL_ENGINE_H
+#define FRACTAL_ENGINE_H
+
+#include "fractal_fixed.h"
+
+#include "glm.hpp"
+
+#include <float.h>
+
+namespace fractal
+{
+    // Where the explorer looks, at whatever precision the zoom needs
+
+    struct View
+    {
+        Fixed centerX, centerY;
+        double rangeX;          // Width in the complex plane, height follows the image aspect ratio
+
+        // Keeps enough fraction limbs in the center that panning by a fraction of a pixel still registers
+        void FitPrecision(int imageWidth) noexcept
+        {
+            const int limbs = Fixed::LimbsFor(rangeX / imageWidth);
+            if (limbs > centerX.LimbCount()) centerX.SetLimbCount(limbs);
+            if (limbs > centerY.LimbCount()) centerY.SetLimbCount(limbs);
+        }
+    };
+
+    // Everything needed to produce one frame, with the same meaning as the
+    // uniforms of res/mandelbrot_cs.glsl
+
+    struct Frame
+    {
+        glm::dvec4 rangeRect;   // uRangeRect: x, y of the bottom left corner, then w, h in the complex plane
+        glm::ivec2 imageDim;    // uImageDim
+        int iteration;          // uIteration
+
+        // Center of rangeRect at full precision, for engines iterating deltas around a reference point.
+        // Only set by MakeFrame().
+        Fixed centerX, centerY;
+    };
+
+    inline Frame MakeFrame(const View& view, glm::ivec2 imageDim, int iteration)
+    {
+        const double rangeY = view.rangeX * imageDim.y / imageDim.x;
+        return {
+            { view.centerX.ToDouble() - view.rangeX / 2, view.centerY.ToDouble() - rangeY / 2, view.rangeX, rangeY },
+            imageDim,
+            iteration,
+            view.centerX, view.centerY
+        };
+    }
+
+    // The pixels [offset, offset + dim) of frame as a frame of their own, at the same pixel spacing,
+    // for rendering pictures bigger than an engine takes in tiles. Needs a frame from MakeFrame().
+
+    inline Frame SubFrame(const Frame& frame, glm::ivec2 offset, glm::ivec2 dim)
+    {
+        const glm::dvec2 spacing = glm::dvec2(frame.rangeRect.z, frame.rangeRect.w) / glm::dvec2(frame.imageDim);
+        const glm::dvec2 shift = (glm::dvec2(offset) + 0.5 * glm::dvec2(dim - frame.imageDim)) * spacing;
+
+        return {
+            { frame.rangeRect.x + offset.x * spacing.x, frame.rangeRect.y + offset.y * spacing.y, dim.x * spacing.x, dim.y * spacing.y },
+            dim,
+            frame.iteration,
+            frame.centerX + Fixed(shift.x, frame.centerX.LimbCount()),
+            frame.centerY + Fixed(shift.y, frame.centerY.LimbCount())
+        };
+    }
+
+    // Whole pixel offset between two frames that only differ by a pan, pixel p of "to" showing
+    // what pixel p + offset of "from" showed. False when anything else changed, or nothing overlaps.
+    // Needs frames from MakeFrame().
+
+    inline bool PanOffset(const Frame& from, const Frame& to, glm::ivec2& offset) noexcept
+    {
+        if (from.imageDim != to.imageDim || from.iteration != to.iteration ||
+            from.rangeRect.z != to.rangeRect.z || from.rangeRect.w != to.rangeRect.w)
+        {
+            return false;
+        }
+
+        const glm::dvec2 spacing = glm::dvec2(to.rangeRect.z, to.rangeRect.w) / glm::dvec2(to.imageDim);
+        const glm::dvec2 pixels = {
+            (to.centerX - from.centerX).ToDouble() / spacing.x,
+            (to.centerY - from.centerY).ToDouble() / spacing.y
+        };
+        const glm::dvec2 rounded = glm::round(pixels);
+
+        if (glm::abs(pixels.x - rounded.x) > 1e-3 || glm::abs(pixels.y - rounded.y) > 1e-3 ||
+            glm::abs(rounded.x) >= to.imageDim.x || glm::abs(rounded.y) >= to.imageDim.y)
+        {
+            return false;
+        }
+
+        offset = glm::ivec2(rounded);
+        return true;
+    }
+
+    // Relative precision of a double-float (hi + lo) number, a few bits short of 2 * 24
+    constexpr double DOUBLE_FLOAT_EPSILON = 1.0 / (double)(1ull << 46);
+
+    // Whether numbers with relative precision epsilon still tell neighbouring pixels apart. Past that,
+    // iterating neighbouring points that round to the same number gives the view a blocky look.
+
+    inline bool PrecisionResolves(const Frame& frame, double epsilon) noexcept
+    {
+        constexpr double ulpsPerPixel = 8.0;   // Iterating amplifies rounding error, so keep some margin
+
+        const double magnitude = glm::max(
+            glm::max(glm::abs(frame.rangeRect.x), glm::abs(frame.rangeRect.x + frame.rangeRect.z)),
+            glm::max(glm::abs(frame.rangeRect.y), glm::abs(frame.rangeRect.y + frame.rangeRect.w))
+        );
+        const double pixelSpacing = glm::min(frame.rangeRect.z / frame.imageDim.x, frame.rangeRect.w / frame.imageDim.y);
+
+        return pixelSpacing >= magnitude * epsilon * ulpsPerPixel;
+    }
+
+    inline bool FloatResolves(const Frame& frame) noexcept
+    {
+        return PrecisionResolves(frame, FLT_EPSILON);
+    }
+
+    class FractalEngine
+    {
+    public:
+
+        virtual ~FractalEngine() = default;
+
+        virtual const char* Name() const noexcept = 0;
+        virtual void Compute(const Frame& frame) = 0;
+    };
+};
+
+#endif // FRACTAL_ENGINE_H
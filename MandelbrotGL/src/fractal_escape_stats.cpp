@@ -0,0 +1,50 @@
+#include "fractal_escape_stats.h"
+
+namespace fractal
+{
+    EscapeStats ReduceEscapeStats(const uint32_t* pixels, glm::ivec2 dim, size_t stride, int iteration) noexcept
+    {
+        EscapeStats stats = {};
+        stats.pixels = (unsigned long long)dim.x * dim.y;
+
+        for (int y = 0; y < dim.y; y++)
+        {
+            const uint32_t* row = pixels + (size_t)y * stride;
+            for (int x = 0; x < dim.x; x++)
+            {
+                const uint32_t it = row[x];
+                if (it == 0 || it >= (uint32_t)iteration)
+                {
+                    stats.inside++;
+                    continue;
+                }
+
+                int bin = 0;
+                for (uint32_t bits = it >> 1; bits != 0; bits >>= 1)
+                {
+                    bin++;
+                }
+                stats.histogram[bin]++;
+                stats.late += (2 * it >= (uint32_t)iteration);
+                stats.maxEscape = glm::max(stats.maxEscape, it);
+            }
+        }
+
+        return stats;
+    }
+
+    int PickIteration(const EscapeStats& stats, int iteration, const IterationBounds& bounds) noexcept
+    {
+        int next = iteration;
+        if (stats.inside > 0 && (double)stats.late > bounds.lateFraction * (double)stats.pixels)
+        {
+            next = (iteration > bounds.maxIteration / 2) ? bounds.maxIteration : 2 * iteration;
+        }
+        else if (stats.maxEscape > 0 && stats.maxEscape < (unsigned int)iteration / 4)
+        {
+            next = 2 * (int)stats.maxEscape;
+        }
+
+        return glm::clamp(next, bounds.minIteration, bounds.maxIteration);
+    }
+};
@@ -0,0 +1,42 @@
+#ifndef FRACTAL_ESCAPE_STATS_H
+#define FRACTAL_ESCAPE_STATS_H
+
+#include "glm.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace fractal
+{
+    // What the escape iterations of a frame say about its iteration cap. Iterations at or above
+    // the cap count as inside, as the fragment shader shows them after the cap went down.
+
+    struct EscapeStats
+    {
+        static constexpr int BINS = 32;
+
+        unsigned long long pixels;
+        unsigned long long inside;
+        unsigned long long late;                // Escaped in the upper half of the iterations
+        unsigned int maxEscape;                 // 0 if nothing escaped
+        unsigned long long histogram[BINS];     // Escapes in [2^i, 2^(i + 1))
+    };
+
+    // dim pixels, rows stride apart, reduced on the calling thread
+    EscapeStats ReduceEscapeStats(const uint32_t* pixels, glm::ivec2 dim, size_t stride, int iteration) noexcept;
+
+    struct IterationBounds
+    {
+        int minIteration;
+        int maxIteration;
+        double lateFraction;    // Of the pixels escaping late, above which the ones inside may escape too
+    };
+
+    // Iteration for the next frame of the view stats were taken from at iteration: doubled while more
+    // than lateFraction of the pixels escape in its upper half and some are still inside, down to twice
+    // the highest escape once that is below a quarter of it, which shows the same picture for less.
+    // A frame where nothing escaped says nothing either way, and keeps its iteration.
+    int PickIteration(const EscapeStats& stats, int iteration, const IterationBounds& bounds) noexcept;
+};
+
+#endif // FRACTAL_ESCAPE_STATS_H
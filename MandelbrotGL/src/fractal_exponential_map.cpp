@@ -0,0 +1,207 @@
+#include "fractal_exponential_map.h"
+#include "fractal_palette.h"
+
+#include <chrono>
+#include <math.h>
+
+namespace fractal
+{
+    constexpr double TWO_PI = 6.283185307179586;
+    constexpr double LN2 = 0.6931471805599453;
+
+    static int roundUp(double value, int multiple)
+    {
+        return ((int)ceil(value) + multiple - 1) / multiple * multiple;
+    }
+
+    ExponentialMap::ExponentialMap(const Fixed& centerX, const Fixed& centerY, double rangeX, double minRangeX, glm::ivec2 frameDim,
+        int iteration, unsigned int threadCount):
+        centerX(centerX),
+        centerY(centerY),
+        frameDim(frameDim),
+        iteration(iteration),
+        engine(threadCount),
+        scheduler(threadCount)
+    {
+        // One sample per pixel around the circle through the corners, each mip level halving both ways
+        const double diagonal = glm::length(glm::dvec2(frameDim));
+        const int mipMultiple = 1 << (MIP_LEVELS - 1);
+        octaveDim.x = roundUp(TWO_PI * diagonal / 2.0, mipMultiple);
+        octaveDim.y = roundUp(LN2 * octaveDim.x / TWO_PI, mipMultiple);
+        step = LN2 / octaveDim.y;
+
+        // From the corners of the widest frame to half a pixel of the narrowest
+        outerRadius = rangeX / frameDim.x * diagonal / 2.0;
+        const double innerRadius = minRangeX / frameDim.x / 2.0;
+        octaveCount = glm::max(1, (int)ceil(log2(outerRadius / innerRadius)));
+    }
+
+    void ExponentialMap::RenderFrame(double rangeX, std::vector<uint8_t>& rgb)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        const double spacing = rangeX / frameDim.x;
+        const double diagonal = glm::length(glm::dvec2(frameDim));
+
+        // Octaves from the corners to half a pixel from the center, a row of margin for filtering
+        auto octaveAt = [this](double radius, double margin)
+        {
+            const double row = log(outerRadius / radius) / step + margin;
+            return glm::clamp((int)floor(row / octaveDim.y), 0, octaveCount - 1);
+        };
+        const int first = octaveAt(spacing * diagonal / 2.0, -1.5);
+        const int last = octaveAt(spacing / 2.0, 1.5);
+
+        while (octaves.empty() == false && octaves.front().index < first)
+        {
+            octaves.pop_front();
+        }
+
+        stats.octavesComputed = 0;
+        for (int index = octaves.empty() ? first : octaves.back().index + 1; index <= last; index++)
+        {
+            computeOctave(index);
+            stats.octavesComputed++;
+        }
+        stats.octavesHeld = (unsigned int)octaves.size();
+
+        auto computed = std::chrono::steady_clock::now();
+
+        // Each pixel reads the mip levels whose rows are about as far apart as the pixels
+        rgb.resize((size_t)frameDim.x * frameDim.y * 3);
+        scheduler.Run(frameDim, [&](const Tile& tile, unsigned int)
+        {
+            for (int y = tile.y; y < tile.y + tile.h; y++)
+            {
+                uint8_t* out = rgb.data() + ((size_t)y * frameDim.x + tile.x) * 3;
+                for (int x = tile.x; x < tile.x + tile.w; x++, out += 3)
+                {
+                    const glm::dvec2 position = glm::dvec2(x + 0.5 - frameDim.x / 2.0, frameDim.y / 2.0 - y - 0.5) * spacing;
+                    const double radius = glm::max(glm::length(position), spacing / 4.0);
+                    double angle = atan2(position.y, position.x);
+                    angle = (angle < 0.0) ? angle + TWO_PI : angle;
+
+                    const double row = log(outerRadius / radius) / step;
+                    const double lod = glm::clamp(log2(spacing / (radius * step)), 0.0, (double)(MIP_LEVELS - 1));
+                    const int level = glm::min((int)lod, MIP_LEVELS - 2);
+                    const double blend = lod - level;
+
+                    glm::vec3 color(0.0f);
+                    for (int i = 0; i < 2; i++)
+                    {
+                        const double scale = 1.0 / (1 << (level + i));
+                        const double weight = (i == 0) ? 1.0 - blend : blend;
+                        if (weight > 0.0)
+                        {
+                            color += (float)weight * sample(level + i, angle / TWO_PI * octaveDim.x * scale - 0.5, row * scale - 0.5);
+                        }
+                    }
+
+                    out[0] = (uint8_t)(color.r + 0.5f);
+                    out[1] = (uint8_t)(color.g + 0.5f);
+                    out[2] = (uint8_t)(color.b + 0.5f);
+                }
+            }
+        });
+
+        auto end = std::chrono::steady_clock::now();
+        stats.computeMs = std::chrono::duration<double, std::milli>(computed - start).count();
+        stats.resampleMs = std::chrono::duration<double, std::milli>(end - computed).count();
+    }
+
+    void ExponentialMap::computeOctave(int index)
+    {
+        const double radius = outerRadius * exp2(-index);
+        const Frame frame = { { -radius, -radius, 2.0 * radius, 2.0 * radius }, octaveDim, iteration, centerX, centerY };
+        const double firstRow = (double)index * octaveDim.y;
+
+        // Row 0 outermost, so the corners are the farthest pixels as the engine wants
+        engine.Compute(frame, [this, firstRow](int x, int y)
+        {
+            const double r = outerRadius * exp(-(firstRow + y + 0.5) * step);
+            const double angle = TWO_PI * (x + 0.5) / octaveDim.x;
+            return glm::dvec2(r * cos(angle), r * sin(angle));
+        });
+
+        octaves.emplace_back();
+        Octave& octave = octaves.back();
+        octave.index = index;
+
+        const std::vector<uint32_t>& pixels = engine.Pixels();
+        octave.levels[0].resize(pixels.size() * 3);
+        scheduler.Run(octaveDim, [&](const Tile& tile, unsigned int)
+        {
+            for (int y = tile.y; y < tile.y + tile.h; y++)
+            {
+                const size_t row = (size_t)y * octaveDim.x;
+                for (int x = tile.x; x < tile.x + tile.w; x++)
+                {
+                    const glm::u8vec3 color = PaletteColor(PaletteShade(pixels[row + x], iteration));
+                    uint8_t* out = octave.levels[0].data() + (row + x) * 3;
+                    out[0] = color.r;
+                    out[1] = color.g;
+                    out[2] = color.b;
+                }
+            }
+        });
+
+        for (int level = 1; level < MIP_LEVELS; level++)
+        {
+            const glm::ivec2 below = octaveDim >> (level - 1);
+            const glm::ivec2 dim = octaveDim >> level;
+            const uint8_t* in = octave.levels[level - 1].data();
+            std::vector<uint8_t>& out = octave.levels[level];
+            out.resize((size_t)dim.x * dim.y * 3);
+
+            for (int y = 0; y < dim.y; y++)
+            {
+                for (int x = 0; x < dim.x; x++)
+                {
+                    const uint8_t* a = in + ((size_t)(2 * y) * below.x + 2 * x) * 3;
+                    const uint8_t* b = a + (size_t)below.x * 3;
+                    for (int c = 0; c < 3; c++)
+                    {
+                        out[((size_t)y * dim.x + x) * 3 + c] = (uint8_t)((a[c] + a[c + 3] + b[c] + b[c + 3] + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+    // Bilinear, wrapping around in angle; rows past the octaves held repeat the nearest one
+
+    glm::vec3 ExponentialMap::sample(int level, double column, double row) const noexcept
+    {
+        const int columns = octaveDim.x >> level;
+        const double columnFloor = floor(column);
+        const double rowFloor = floor(row);
+        const float fx = (float)(column - columnFloor);
+        const float fy = (float)(row - rowFloor);
+
+        int x0 = (int)columnFloor % columns;
+        x0 = (x0 < 0) ? x0 + columns : x0;
+        const int x1 = (x0 + 1 == columns) ? 0 : x0 + 1;
+        const int y0 = (int)rowFloor;
+
+        glm::vec3 rows[2];
+        for (int i = 0; i < 2; i++)
+        {
+            const uint8_t* in = levelRow(level, y0 + i);
+            const glm::vec3 left(in[x0 * 3], in[x0 * 3 + 1], in[x0 * 3 + 2]);
+            const glm::vec3 right(in[x1 * 3], in[x1 * 3 + 1], in[x1 * 3 + 2]);
+            rows[i] = glm::mix(left, right, fx);
+        }
+        return glm::mix(rows[0], rows[1], fy);
+    }
+
+    const uint8_t* ExponentialMap::levelRow(int level, int row) const noexcept
+    {
+        const glm::ivec2 dim = octaveDim >> level;
+        const int first = octaves.front().index * dim.y;
+        const int last = (octaves.back().index + 1) * dim.y - 1;
+        row = glm::clamp(row, first, last);
+
+        const Octave& octave = octaves[row / dim.y - octaves.front().index];
+        return octave.levels[level].data() + (size_t)(row % dim.y) * dim.x * 3;
+    }
+};
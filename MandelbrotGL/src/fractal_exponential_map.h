@@ -0,0 +1,90 @@
+#ifndef FRACTAL_EXPONENTIAL_MAP_H
+#define FRACTAL_EXPONENTIAL_MAP_H
+
+#include "fractal_fixed.h"
+#include "fractal_perturbation_engine.h"
+#include "fractal_scheduler.h"
+
+#include "glm.hpp"
+
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Frames of a zoom video around a fixed center, resampled from a log-polar ("exponential map")
+    // picture of the set instead of each being computed.
+    //
+    // Column x of the map is the angle 2 pi (x + 0.5) / width around the center, row k the radius
+    // outerRadius * exp(-(k + 0.5) * step), so every sample is about as wide as it is high and
+    // stays so at any zoom. width is set for the corners of every frame to get one sample per
+    // pixel; pixels nearer the center get more and read a mip level of the map instead.
+    //
+    // The map is computed one octave of radius at a time, by PerturbationEngine around a single
+    // reference at the center. A frame reaches about log2(frame diagonal) octaves, so frames have
+    // to come with a shrinking range: octaves are computed when the zoom gets to them and dropped
+    // once it has gone past.
+
+    class ExponentialMap
+    {
+    public:
+
+        struct Stats
+        {
+            unsigned int octavesComputed;
+            unsigned int octavesHeld;
+            double computeMs;
+            double resampleMs;
+        };
+
+        // Frames of frameDim from one whose width is rangeX down to one whose pixels are
+        // minRangeX / frameDim.x apart
+        ExponentialMap(const Fixed& centerX, const Fixed& centerY, double rangeX, double minRangeX, glm::ivec2 frameDim,
+            int iteration, unsigned int threadCount = TileScheduler::DefaultThreadCount());
+
+        ExponentialMap(const ExponentialMap&) = delete;
+        ExponentialMap(ExponentialMap&&) = delete;
+        ExponentialMap& operator=(const ExponentialMap&) = delete;
+        ExponentialMap& operator=(ExponentialMap&&) = delete;
+
+        // Columns, then rows of one octave
+        glm::ivec2 OctaveDim() const noexcept { return octaveDim; }
+        int OctaveCount() const noexcept { return octaveCount; }
+
+        // RGB of the frame rangeX wide, top row first, no wider than the previous one
+        void RenderFrame(double rangeX, std::vector<uint8_t>& rgb);
+
+        Stats LastStats() const noexcept { return stats; }
+
+    private:
+
+        static constexpr int MIP_LEVELS = 7;   // Down to 64x fewer samples each way
+
+        // Each mip level halves columns and rows, RGB with rows from the outside in
+        struct Octave
+        {
+            int index;
+            std::vector<uint8_t> levels[MIP_LEVELS];
+        };
+
+        void computeOctave(int index);
+        glm::vec3 sample(int level, double column, double row) const noexcept;
+        const uint8_t* levelRow(int level, int row) const noexcept;
+
+        Fixed centerX, centerY;
+        double outerRadius;
+        double step;        // Of log radius from one row to the next
+        glm::ivec2 frameDim;
+        glm::ivec2 octaveDim;
+        int octaveCount;
+        int iteration;
+        Stats stats = { 0, 0, 0.0, 0.0 };
+
+        PerturbationEngine engine;
+        TileScheduler scheduler;
+        std::deque<Octave> octaves;     // Consecutive indices
+    };
+};
+
+#endif // FRACTAL_EXPONENTIAL_MAP_H
@@ -0,0 +1,260 @@
+#include "fractal_fixed.h"
+
+#include <math.h>
+
+namespace fractal
+{
+    static int clampLimbCount(int limbCount) noexcept
+    {
+        if (limbCount < 1) return 1;
+        if (limbCount > Fixed::MAX_LIMBS) return Fixed::MAX_LIMBS;
+        return limbCount;
+    }
+
+    Fixed::Fixed(int limbCount) noexcept:
+        count(clampLimbCount(limbCount))
+    {
+        for (int i = 0; i < count; i++)
+        {
+            limbs[i] = 0;
+        }
+    }
+
+    Fixed::Fixed(double value, int limbCount) noexcept:
+        Fixed(limbCount)
+    {
+        // Convert the magnitude, a tiny negative value would otherwise round "1 - tiny" to 1
+        double magnitude = fabs(value);
+        double integer = floor(magnitude);
+        limbs[0] = (uint32_t)integer;
+
+        double fraction = magnitude - integer;
+        for (int i = 1; i < count && fraction != 0.0; i++)
+        {
+            fraction *= 4294967296.0;
+            double limbValue = floor(fraction);
+            limbs[i] = (uint32_t)limbValue;
+            fraction -= limbValue;
+        }
+
+        if (value < 0.0)
+        {
+            negate();
+        }
+    }
+
+    Fixed Fixed::FromString(const char* text, int limbCount) noexcept
+    {
+        Fixed result(limbCount);
+
+        const char* p = text;
+        while (*p == ' ' || *p == '\t')
+        {
+            p++;
+        }
+
+        const bool negative = (*p == '-');
+        if (*p == '-' || *p == '+')
+        {
+            p++;
+        }
+
+        uint32_t integer = 0;
+        for (; *p >= '0' && *p <= '9'; p++)
+        {
+            integer = integer * 10 + (uint32_t)(*p - '0');
+        }
+
+        if (*p == '.')
+        {
+            const char* first = ++p;
+            while (*p >= '0' && *p <= '9')
+            {
+                p++;
+            }
+
+            // Horner's scheme from the last digit: fraction = (digit + fraction) / 10
+            for (const char* digit = p; digit > first; )
+            {
+                digit--;
+                result.limbs[0] = (uint32_t)(*digit - '0');
+                result.divideSmall(10);
+            }
+        }
+
+        result.limbs[0] = integer;
+        if (negative)
+        {
+            result.negate();
+        }
+        return result;
+    }
+
+    std::string Fixed::ToString(int fractionDigits) const
+    {
+        Fixed magnitude = (IsNegative()) ? -*this : *this;
+
+        std::string text = (IsNegative()) ? "-" : "";
+        text += std::to_string(magnitude.limbs[0]);
+
+        if (fractionDigits > 0)
+        {
+            text += '.';
+            for (int i = 0; i < fractionDigits; i++)
+            {
+                magnitude.limbs[0] = 0;
+                magnitude.multiplySmall(10);
+                text += (char)('0' + magnitude.limbs[0]);
+            }
+        }
+
+        return text;
+    }
+
+    double Fixed::ToDouble() const noexcept
+    {
+        if (IsNegative())
+        {
+            return -(-*this).ToDouble();
+        }
+
+        double result = (double)limbs[0];
+        double scale = 1.0;
+        for (int i = 1; i < count; i++)
+        {
+            scale *= 1.0 / 4294967296.0;
+            result += (double)limbs[i] * scale;
+        }
+        return result;
+    }
+
+    void Fixed::SetLimbCount(int limbCount) noexcept
+    {
+        limbCount = clampLimbCount(limbCount);
+        for (int i = count; i < limbCount; i++)
+        {
+            limbs[i] = 0;
+        }
+        count = limbCount;
+    }
+
+    int Fixed::LimbsFor(double pixelSpacing) noexcept
+    {
+        constexpr int guardBits = 64;
+
+        int bits = (int)ceil(-log2(pixelSpacing)) + guardBits;
+        if (bits < 32)
+        {
+            bits = 32;
+        }
+        return clampLimbCount(1 + (bits + 31) / 32);
+    }
+
+    // Arithmetic
+
+    Fixed Fixed::operator-() const noexcept
+    {
+        Fixed result = *this;
+        result.negate();
+        return result;
+    }
+
+    Fixed Fixed::operator+(const Fixed& rhs) const noexcept
+    {
+        Fixed result((count > rhs.count) ? count : rhs.count);
+
+        uint64_t carry = 0;
+        for (int i = result.count - 1; i >= 0; i--)
+        {
+            uint64_t sum = (uint64_t)limb(i) + rhs.limb(i) + carry;
+            result.limbs[i] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+        return result;
+    }
+
+    Fixed Fixed::operator-(const Fixed& rhs) const noexcept
+    {
+        return *this + (-rhs);
+    }
+
+    Fixed Fixed::operator*(const Fixed& rhs) const noexcept
+    {
+        const int n = (count > rhs.count) ? count : rhs.count;
+        const bool negative = IsNegative() != rhs.IsNegative();
+
+        Fixed a = (IsNegative()) ? -*this : *this;
+        Fixed b = (rhs.IsNegative()) ? -rhs : rhs;
+        a.SetLimbCount(n);
+        b.SetLimbCount(n);
+
+        // Schoolbook product of the magnitudes, least significant limb first.
+        // Limb i of a number is the (n - 1 - i)th from the end.
+        uint32_t product[2 * MAX_LIMBS] = {};
+        for (int i = 0; i < n; i++)
+        {
+            const uint64_t ai = a.limbs[n - 1 - i];
+            if (ai == 0)
+            {
+                continue;
+            }
+
+            uint64_t carry = 0;
+            for (int j = 0; j < n; j++)
+            {
+                uint64_t t = ai * b.limbs[n - 1 - j] + product[i + j] + carry;
+                product[i + j] = (uint32_t)t;
+                carry = t >> 32;
+            }
+            product[i + n] = (uint32_t)carry;
+        }
+
+        // Drop the n - 1 extra fraction limbs
+        Fixed result(n);
+        for (int k = 0; k < n; k++)
+        {
+            result.limbs[n - 1 - k] = product[k + n - 1];
+        }
+
+        if (negative)
+        {
+            result.negate();
+        }
+        return result;
+    }
+
+    void Fixed::negate() noexcept
+    {
+        uint64_t carry = 1;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            uint64_t sum = (uint64_t)(~limbs[i]) + carry;
+            limbs[i] = (uint32_t)sum;
+            carry = sum >> 32;
+        }
+    }
+
+    uint32_t Fixed::divideSmall(uint32_t divisor) noexcept
+    {
+        uint64_t remainder = 0;
+        for (int i = 0; i < count; i++)
+        {
+            uint64_t current = (remainder << 32) | limbs[i];
+            limbs[i] = (uint32_t)(current / divisor);
+            remainder = current % divisor;
+        }
+        return (uint32_t)remainder;
+    }
+
+    uint32_t Fixed::multiplySmall(uint32_t factor) noexcept
+    {
+        uint64_t carry = 0;
+        for (int i = count - 1; i >= 0; i--)
+        {
+            uint64_t t = (uint64_t)limbs[i] * factor + carry;
+            limbs[i] = (uint32_t)t;
+            carry = t >> 32;
+        }
+        return (uint32_t)carry;
+    }
+};
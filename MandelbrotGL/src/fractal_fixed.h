@@ -0,0 +1,64 @@
+#ifndef FRACTAL_FIXED_H
+#define FRACTAL_FIXED_H
+
+#include <string>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Signed fixed point number with a 32 bit integer part and a variable number of 32 bit fraction limbs,
+    // for the view center and reference orbits of deep zooms. Everything the Mandelbrot set needs
+    // stays well inside the integer part, so overflow isn't checked.
+    //
+    // Stored in two's complement, limbs[0] being the integer part and limbs[1...] the fraction,
+    // most significant first. Appending zero limbs keeps the value, so operands of different
+    // precision are combined at the larger one.
+
+    class Fixed
+    {
+    public:
+
+        static constexpr int MAX_LIMBS = 32;   // 992 fraction bits, past what a double delta can address anyway
+
+        Fixed() noexcept: Fixed(2) {}
+        explicit Fixed(int limbCount) noexcept;
+        Fixed(double value, int limbCount) noexcept;
+
+        // Plain decimal, "-0.743643887037158704752191506114774"
+        static Fixed FromString(const char* text, int limbCount) noexcept;
+        std::string ToString(int fractionDigits) const;
+
+        double ToDouble() const noexcept;
+        bool IsNegative() const noexcept { return (limbs[0] & 0x80000000u) != 0; }
+
+        int LimbCount() const noexcept { return count; }
+        void SetLimbCount(int limbCount) noexcept;     // Truncates or zero extends the fraction
+
+        // Enough limbs to tell apart points pixelSpacing apart, with guard bits for iterating
+        static int LimbsFor(double pixelSpacing) noexcept;
+
+        Fixed operator-() const noexcept;
+        Fixed operator+(const Fixed& rhs) const noexcept;
+        Fixed operator-(const Fixed& rhs) const noexcept;
+        Fixed operator*(const Fixed& rhs) const noexcept;
+        Fixed& operator+=(const Fixed& rhs) noexcept { return *this = *this + rhs; }
+        Fixed& operator-=(const Fixed& rhs) noexcept { return *this = *this - rhs; }
+
+        Fixed Square() const noexcept { return *this * *this; }
+        Fixed Twice() const noexcept { return *this + *this; }
+
+    private:
+
+        void negate() noexcept;
+        uint32_t limb(int i) const noexcept { return (i < count) ? limbs[i] : 0; }
+
+        // Helpers on the unsigned magnitude, used by parsing and printing
+        uint32_t divideSmall(uint32_t divisor) noexcept;
+        uint32_t multiplySmall(uint32_t factor) noexcept;
+
+        uint32_t limbs[MAX_LIMBS];
+        int count;
+    };
+};
+
+#endif // FRACTAL_FIXED_H
@@ -0,0 +1,556 @@
+#include "fractal_gpu_engine.h"
+#include "fractal_trace.h"
+#include "gl_constants.h"
+
+#include <chrono>
+#include <stdio.h>
+
+namespace fractal
+{
+    // Nearest float, and the float nearest to what it misses
+
+    static void splitDouble(double value, float& hi, float& lo)
+    {
+        hi = (float)value;
+        lo = (float)(value - (double)hi);
+    }
+
+    static std::unique_ptr<gl::ComputeShader> makeOptionalShader(const char* path, unsigned int imageSlot)
+    {
+        std::unique_ptr<gl::ComputeShader> shader(new gl::ComputeShader(path));
+        if (shader->Linked() == false)
+        {
+            return nullptr;
+        }
+
+        shader->Bind();
+        shader->SetUniform1i("uImage", imageSlot);
+        return shader;
+    }
+
+    GpuEngine::GpuEngine(const ShaderPaths& paths, unsigned int imageSlot):
+        floatShader(paths.floatPath),
+        imageSlot(imageSlot),
+        scratch(gl::TextureTarget::TEX2D, gl::PixelFormat::R32UI, gl::TextureWrap::CHOP),
+        stateZ(gl::TextureTarget::TEX2D, gl::PixelFormat::RGBA32UI, gl::TextureWrap::CHOP)
+    {
+        floatShader.Bind();
+        floatShader.SetUniform1i("uImage", imageSlot);
+
+        // Needs fma() and "precise" from GLSL 4.00
+        doubleFloatShader = makeOptionalShader(paths.doubleFloatPath, imageSlot);
+
+        if (GLEW_VERSION_4_0 || GLEW_ARB_gpu_shader_fp64)
+        {
+            doubleShader = makeOptionalShader(paths.doublePath, imageSlot);
+        }
+
+        if (doubleShader == nullptr)
+        {
+            printf("fp64 compute shader unavailable, deep zoom falls back to double-float\n");
+        }
+
+        if (paths.subdivisionPath)
+        {
+            subdivisionShader = makeOptionalShader(paths.subdivisionPath, imageSlot);
+        }
+    }
+
+    void GpuEngine::Validate()
+    {
+        floatShader.Validate();
+        if (doubleFloatShader)
+        {
+            doubleFloatShader->Validate();
+        }
+        if (doubleShader)
+        {
+            doubleShader->Validate();
+        }
+        if (subdivisionShader)
+        {
+            subdivisionShader->Validate();
+        }
+    }
+
+    void GpuEngine::EnableIterationResume(unsigned int stateSlot)
+    {
+        this->stateSlot = stateSlot;
+        iterationResume = true;
+        stateValid = false;
+        refineStride = 0;       // Passes done so far didn't keep z
+
+        setUniform1i("uStateZ", stateSlot);
+    }
+
+    void GpuEngine::SetSmoothImage(gl::Texture* image, unsigned int slot)
+    {
+        smoothImage = image;
+        hasLastFrame = false;   // Would only shift stale values
+        stateValid = false;
+        refineStride = 0;
+
+        if (image)
+        {
+            setUniform1i("uSmooth", slot);
+        }
+    }
+
+    void GpuEngine::SetInteriorChecks(bool enable)
+    {
+        if (enable != interiorChecks)
+        {
+            interiorChecks = enable;
+            setUniform1i("uInteriorChecks", enable);
+        }
+    }
+
+    void GpuEngine::Compute(const Frame& frame)
+    {
+        const Precision framePrecision = pickPrecision(frame);
+
+        if (iterationResume)
+        {
+            bindState(frame.imageDim);
+        }
+
+        // Same view, more iterations
+        resumed = iterationResume && stateValid && framePrecision == lastPrecision &&
+            frame.imageDim == lastFrame.imageDim && frame.rangeRect == lastFrame.rangeRect &&
+            frame.iteration > lastFrame.iteration;
+
+        // Same view, not refined to the end yet
+        const bool refining = progressive && refineStride > 0 && framePrecision == lastPrecision &&
+            frame.imageDim == lastFrame.imageDim && frame.rangeRect == lastFrame.rangeRect &&
+            frame.iteration == lastFrame.iteration;
+
+        if (refining == false)
+        {
+            refineStride = 0;
+            lastStride = 1;
+        }
+
+        glm::ivec2 offset;
+        subdivided = false;
+        if (refining)
+        {
+            refine(progressiveBudgetMs);
+        }
+        else if (resumed)
+        {
+            dispatch(framePrecision, frame, { 0, 0, frame.imageDim.x, frame.imageDim.y }, true);
+            computedFraction = 1.0;
+        }
+        else if (reprojectionImage && hasLastFrame && framePrecision == lastPrecision && PanOffset(lastFrame, frame, offset))
+        {
+            reproject(framePrecision, frame, offset);
+            stateValid &= (offset.x == 0 && offset.y == 0);
+        }
+        else if (subdivision && subdivisionShader && framePrecision == Precision::FLOAT &&
+            frame.imageDim.x > 1 && frame.imageDim.y > 1)
+        {
+            subdivide(frame);
+            subdivided = true;
+            stateValid = false;     // z isn't kept
+        }
+        else if (progressive)
+        {
+            lastPrecision = framePrecision;
+            lastFrame = frame;
+            refineStride = PROGRESSIVE_STRIDE;
+            stateValid = false;
+            refine(progressiveBudgetMs);
+        }
+        else
+        {
+            dispatch(framePrecision, frame);
+            computedFraction = 1.0;
+            stateValid = iterationResume;
+        }
+
+        lastPrecision = framePrecision;
+        lastFrame = frame;
+        hasLastFrame = (reprojectionImage != nullptr) && refineStride == 0;
+
+        // Image access too, for the state the next frame may resume from
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    void GpuEngine::Compute(const Frame& frame, const std::vector<Tile>& regions)
+    {
+        const Precision framePrecision = pickPrecision(frame);
+        if (iterationResume)
+        {
+            bindState(frame.imageDim);
+        }
+
+        unsigned long long pixels = 0;
+        for (const Tile& region : regions)
+        {
+            dispatch(framePrecision, frame, region);
+            pixels += (unsigned long long)region.w * region.h;
+        }
+        computedFraction = (double)pixels / ((double)frame.imageDim.x * frame.imageDim.y);
+
+        lastPrecision = framePrecision;
+        lastFrame = frame;
+        hasLastFrame = false;
+        stateValid = false;
+        resumed = false;
+        refineStride = 0;
+        lastStride = 1;
+
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+
+    void GpuEngine::Refine()
+    {
+        if (refineStride > 0)
+        {
+            refine(progressiveBudgetMs);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+    }
+
+    GpuEngine::BenchmarkResult GpuEngine::Benchmark(const Frame& frame, int repeat)
+    {
+        auto time = [this, &frame, repeat](Precision precision)
+        {
+            dispatch(precision, frame);     // Warm up, the driver may finish compiling on first use
+            glFinish();
+
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < repeat; i++)
+            {
+                dispatch(precision, frame);
+            }
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+
+            return std::chrono::duration<double, std::milli>(end - start).count() / repeat;
+        };
+
+        benchmark.floatMs = time(Precision::FLOAT);
+        benchmark.doubleFloatMs = (doubleFloatShader) ? time(Precision::DOUBLE_FLOAT) : -1.0;
+        benchmark.doubleMs = (doubleShader) ? time(Precision::DOUBLE) : -1.0;
+
+        printf("Benchmark (ms per frame): float %.3f, double-float %.3f, fp64 %.3f\n",
+            benchmark.floatMs, benchmark.doubleFloatMs, benchmark.doubleMs);
+
+        hasLastFrame = false;   // Left with whichever precision ran last
+        stateValid = false;
+        refineStride = 0;
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+        return benchmark;
+    }
+
+    const char* GpuEngine::PrecisionName(Precision precision) noexcept
+    {
+        switch (precision)
+        {
+        case Precision::FLOAT: return "fp32";
+        case Precision::DOUBLE: return "fp64";
+        case Precision::DOUBLE_FLOAT: return "fp32x2";
+        }
+        return "";
+    }
+
+    Precision GpuEngine::pickPrecision(const Frame& frame) const noexcept
+    {
+        if (autoPrecision == false)
+        {
+            if (precision == Precision::DOUBLE && doubleShader) return Precision::DOUBLE;
+            if (precision != Precision::FLOAT && doubleFloatShader) return Precision::DOUBLE_FLOAT;
+            return Precision::FLOAT;
+        }
+
+        if (FloatResolves(frame))
+        {
+            return Precision::FLOAT;
+        }
+
+        const bool doubleFloatResolves = doubleFloatShader && PrecisionResolves(frame, DOUBLE_FLOAT_EPSILON);
+        if (doubleFloatResolves && doubleShader)
+        {
+            // Unless measured otherwise, assume a consumer GPU with slow fp64
+            const bool doubleFaster = benchmark.doubleMs >= 0.0 && benchmark.doubleMs < benchmark.doubleFloatMs;
+            return (doubleFaster) ? Precision::DOUBLE : Precision::DOUBLE_FLOAT;
+        }
+
+        if (doubleShader) return Precision::DOUBLE;
+        if (doubleFloatShader) return Precision::DOUBLE_FLOAT;
+        return Precision::FLOAT;
+    }
+
+    void GpuEngine::reproject(Precision precision, const Frame& frame, glm::ivec2 offset)
+    {
+        const glm::ivec2 dim = frame.imageDim;
+        const glm::ivec2 absOffset = glm::abs(offset);
+
+        if (offset.x == 0 && offset.y == 0)
+        {
+            computedFraction = 0.0;
+            return;
+        }
+
+        if (scratchDim != dim)
+        {
+            scratch.Bind(imageSlot);
+            scratch.UpdatePixelData(dim, nullptr);
+            scratch.Unbind();
+            scratchDim = dim;
+        }
+
+        // Pixel p now shows what p + offset showed, through the scratch copy as the two overlap
+        scratch.CopySubImage(*reprojectionImage, { 0, 0 }, { 0, 0 }, dim);
+        reprojectionImage->CopySubImage(scratch, glm::max(offset, 0), glm::max(-offset, 0), dim - absOffset);
+        if (smoothImage)
+        {
+            // R32F and R32UI are the same size, which is all copies need
+            scratch.CopySubImage(*smoothImage, { 0, 0 }, { 0, 0 }, dim);
+            smoothImage->CopySubImage(scratch, glm::max(offset, 0), glm::max(-offset, 0), dim - absOffset);
+        }
+
+        // The exposed L: full height columns on one side, then rows along the rest of the width
+        unsigned long long pixels = 0;
+        if (offset.x != 0)
+        {
+            const Tile columns = { (offset.x > 0) ? dim.x - offset.x : 0, 0, absOffset.x, dim.y };
+            dispatch(precision, frame, columns);
+            pixels += (unsigned long long)columns.w * columns.h;
+        }
+        if (offset.y != 0)
+        {
+            const Tile rows = { glm::max(-offset.x, 0), (offset.y > 0) ? dim.y - offset.y : 0, dim.x - absOffset.x, absOffset.y };
+            dispatch(precision, frame, rows);
+            pixels += (unsigned long long)rows.w * rows.h;
+        }
+
+        computedFraction = (double)pixels / ((double)dim.x * dim.y);
+    }
+
+    // The first pass computes the border of each square of the grid and what it needs inside, the next
+    // ones the rectangles the pass before split, from its worklist. Rectangles share their borders.
+
+    void GpuEngine::subdivide(const Frame& frame)
+    {
+        const glm::ivec2 grid = (frame.imageDim - 1 + SUBDIVISION_SIZE - 1) / SUBDIVISION_SIZE;
+        int passes = 0;
+        for (int size = SUBDIVISION_SIZE / 2; size >= SUBDIVISION_LEAF; size /= 2)
+        {
+            passes++;
+        }
+
+        // Each pass at most quarters every rectangle
+        const size_t capacity = ((size_t)grid.x * grid.y) << (2 * passes);
+        const GLuint header[4] = { 0, 1, 1, 0 };
+        for (gl::ShaderStorageBuffer& worklist : worklists)
+        {
+            worklist.Bind();
+            if (worklistCapacity < capacity)
+            {
+                worklist.update((unsigned int)(sizeof(header) + capacity * 4 * sizeof(GLint)), nullptr);
+            }
+            worklist.updateSub(0, sizeof(header), header);
+        }
+        worklistCapacity = glm::max(worklistCapacity, capacity);
+
+        gl::ComputeShader& shader = *subdivisionShader;
+        shader.Bind();
+        shader.SetUniform4f("uRangeRect",
+            (float)frame.rangeRect.x, (float)frame.rangeRect.y, (float)frame.rangeRect.z, (float)frame.rangeRect.w
+        );
+        shader.SetUniform2f("uImageDim", (float)frame.imageDim.x, (float)frame.imageDim.y);
+        shader.SetUniform1i("uIteration", frame.iteration);
+        shader.SetUniform1i("uWriteSmooth", smoothImage != nullptr);
+        shader.SetUniform1i("uInitialSize", SUBDIVISION_SIZE);
+        shader.SetUniform1i("uLeafSize", SUBDIVISION_LEAF);
+
+        shader.SetUniform1i("uInitial", true);
+        shader.SetUniform1i("uSplit", passes > 0);
+        worklists[0].BindBase(0);
+        worklists[1].BindBase(1);
+        shader.compute({ grid.x, grid.y, 1 });
+
+        shader.SetUniform1i("uInitial", false);
+        for (int pass = 1; pass <= passes; pass++)
+        {
+            const gl::ShaderStorageBuffer& input = worklists[pass % 2];
+            const gl::ShaderStorageBuffer& output = worklists[(pass + 1) % 2];
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT |
+                GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+            output.Bind();
+            output.updateSub(0, 3 * sizeof(GLuint), header);    // Keeps its pixel count
+            input.BindBase(0);
+            output.BindBase(1);
+            input.BindIndirect();
+
+            shader.SetUniform1i("uSplit", pass < passes);
+            shader.computeIndirect(0);
+        }
+
+        // Small readback of the pixels computed, but it waits for the last pass
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        unsigned long long pixels = 0;
+        for (gl::ShaderStorageBuffer& worklist : worklists)
+        {
+            GLuint computed = 0;
+            worklist.Bind();
+            worklist.read(3 * sizeof(GLuint), sizeof(computed), &computed);
+            pixels += computed;
+        }
+        worklists[0].Unbind();
+        computedFraction = (double)pixels / ((double)frame.imageDim.x * frame.imageDim.y);
+    }
+
+    // Passes of lastFrame from refineStride on. The next one runs if, at the cost per pixel of the
+    // one before, it fits in what is left of the budget.
+
+    void GpuEngine::refine(double budgetMs)
+    {
+        const glm::ivec2 dim = lastFrame.imageDim;
+        auto start = std::chrono::steady_clock::now();
+        double spentMs = 0.0;
+        unsigned long long pixels = 0;
+
+        while (refineStride > 0)
+        {
+            const int stride = refineStride;
+            const glm::ivec2 grid = (dim + stride - 1) / stride;
+            unsigned long long passPixels = (unsigned long long)grid.x * grid.y;
+            if (stride < PROGRESSIVE_STRIDE)
+            {
+                const glm::ivec2 coarser = (dim + 2 * stride - 1) / (2 * stride);
+                passPixels -= (unsigned long long)coarser.x * coarser.y;
+            }
+
+            if (pixels > 0 && spentMs + passPixelMs * passPixels > budgetMs)
+            {
+                break;
+            }
+
+            // Also orders the next pass's stores after this one's
+            dispatch(lastPrecision, lastFrame, { 0, 0, dim.x, dim.y }, false, stride, stride < PROGRESSIVE_STRIDE);
+            glFinish();
+
+            const double nowMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            passPixelMs = (nowMs - spentMs) / (double)passPixels;
+            spentMs = nowMs;
+            pixels += passPixels;
+
+            lastStride = stride;
+            refineStride = stride / 2;
+        }
+
+        computedFraction = (double)pixels / ((double)dim.x * dim.y);
+        if (refineStride == 0)
+        {
+            stateValid = iterationResume;
+            hasLastFrame = (reprojectionImage != nullptr);
+        }
+    }
+
+    void GpuEngine::dispatch(Precision precision, const Frame& frame)
+    {
+        dispatch(precision, frame, { 0, 0, frame.imageDim.x, frame.imageDim.y });
+    }
+
+    // On every program
+
+    void GpuEngine::setUniform1i(const char* name, int value)
+    {
+        floatShader.Bind();
+        floatShader.SetUniform1i(name, value);
+        if (doubleFloatShader)
+        {
+            doubleFloatShader->Bind();
+            doubleFloatShader->SetUniform1i(name, value);
+        }
+        if (doubleShader)
+        {
+            doubleShader->Bind();
+            doubleShader->SetUniform1i(name, value);
+        }
+        if (subdivisionShader)
+        {
+            subdivisionShader->Bind();
+            subdivisionShader->SetUniform1i(name, value);
+        }
+    }
+
+    void GpuEngine::bindState(glm::ivec2 dim)
+    {
+        if (stateDim != dim)
+        {
+            stateZ.Bind(imageSlot);
+            stateZ.UpdatePixelData(dim, nullptr);
+            stateZ.Unbind();
+            stateDim = dim;
+            stateValid = false;
+        }
+
+        stateZ.BindToImageUnit(stateSlot, gl::ImageAccess::READ_WRITE);
+    }
+
+    void GpuEngine::dispatch(Precision precision, const Frame& frame, const Tile& region, bool resume,
+        int stride, bool skipCoarser)
+    {
+        gl::ComputeShader& shader = [this, precision]() -> gl::ComputeShader&
+        {
+            switch (precision)
+            {
+            case Precision::DOUBLE: return *doubleShader;
+            case Precision::DOUBLE_FLOAT: return *doubleFloatShader;
+            default: return floatShader;
+            }
+        }();
+
+        // Uploads apart from the submit, which is what stalls when the driver's queue is full
+        {
+            FRACTAL_TRACE_SCOPE("uniforms");
+            shader.Bind();
+            switch (precision)
+            {
+            case Precision::FLOAT:
+                shader.SetUniform4f("uRangeRect",
+                    (float)frame.rangeRect.x, (float)frame.rangeRect.y, (float)frame.rangeRect.z, (float)frame.rangeRect.w
+                );
+                break;
+
+            case Precision::DOUBLE:
+                shader.SetUniform4d("uRangeRect", frame.rangeRect.x, frame.rangeRect.y, frame.rangeRect.z, frame.rangeRect.w);
+                break;
+
+            case Precision::DOUBLE_FLOAT:
+            {
+                glm::vec4 hi, lo;
+                for (int i = 0; i < 4; i++)
+                {
+                    splitDouble(frame.rangeRect[i], hi[i], lo[i]);
+                }
+                shader.SetUniform4f("uRangeRectHi", hi.x, hi.y, hi.z, hi.w);
+                shader.SetUniform4f("uRangeRectLo", lo.x, lo.y, lo.z, lo.w);
+                break;
+            }
+            }
+            shader.SetUniform2f("uImageDim", (float)frame.imageDim.x, (float)frame.imageDim.y);
+            shader.SetUniform1i("uIteration", frame.iteration);
+            shader.SetUniform2i("uPixelOffset", region.x, region.y);
+            shader.SetUniform1i("uStride", stride);
+            shader.SetUniform1i("uSkipCoarser", skipCoarser);
+            shader.SetUniform1i("uKeepState", iterationResume);
+            shader.SetUniform1i("uResume", resume);
+            shader.SetUniform1i("uLastIteration", lastFrame.iteration);
+            shader.SetUniform1i("uWriteSmooth", smoothImage != nullptr);
+        }
+
+        FRACTAL_TRACE_SCOPE("dispatch");
+        const glm::ivec2 grid = (glm::ivec2(region.w, region.h) + stride - 1) / stride;
+        shader.compute({
+            (grid.x + gl::LOCAL_WORKGROUP_SIZE - 1) / gl::LOCAL_WORKGROUP_SIZE,
+            (grid.y + gl::LOCAL_WORKGROUP_SIZE - 1) / gl::LOCAL_WORKGROUP_SIZE,
+            1
+        });
+    }
+};
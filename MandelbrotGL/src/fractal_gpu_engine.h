@@ -0,0 +1,183 @@
+#ifndef FRACTAL_GPU_ENGINE_H
+#define FRACTAL_GPU_ENGINE_H
+
+#include "fractal_engine.h"
+#include "fractal_kernel.h"
+#include "fractal_scheduler.h"
+#include "gl_buffers.h"
+#include "gl_shader.h"
+#include "gl_texture.h"
+
+#include <memory>
+#include <vector>
+
+namespace fractal
+{
+    // Runs res/mandelbrot_cs.glsl, or one of its wider variants once floats can't resolve the view:
+    // double-float (two floats per number, fast everywhere) or fp64 (slow on consumer GPUs).
+    // The result stays on the GPU, as raw escape iterations in the R32UI texture bound to imageSlot,
+    // optionally with fractional ones in an R32F texture.
+    //
+    // Given that texture, frames that only pan by whole pixels reuse the last result: the texture is
+    // shifted through a scratch copy and only the exposed strips are dispatched. Whatever else writes
+    // to the texture has to call InvalidateImage().
+    //
+    // With iteration resume on, every pixel's z is also kept, in an RGBA32UI image. A frame that only
+    // raises the iteration then continues from there and the iteration already in the texture:
+    // pixels that escaped are just rewritten, and only the ones still inside iterate further.
+    //
+    // With subdivision on, whole fp32 frames go through res/mandelbrot_subdivide_cs.glsl instead:
+    // Mariani-Silver over a worklist of rectangles, one indirect dispatch per level. Filaments thinner
+    // than a pixel can slip between border pixels, so it may differ from the full dispatch there.
+    //
+    // With progressive refinement on, other whole frames are computed coarse to fine instead: every
+    // 8th pixel first, each filling the 8x8 block it stands for, then every 4th, 2nd and 1st, each pass
+    // skipping the pixels the ones before did. Passes run until a time budget is spent; the rest waits
+    // for Refine(), or for the same frame to be computed again.
+
+    class GpuEngine : public FractalEngine
+    {
+    public:
+
+        struct ShaderPaths
+        {
+            const char* floatPath;
+            const char* doubleFloatPath;
+            const char* doublePath;
+            const char* subdivisionPath;    // nullptr without subdivision
+        };
+
+        // Milliseconds per frame, negative if the program isn't available
+        struct BenchmarkResult
+        {
+            double floatMs;
+            double doubleFloatMs;
+            double doubleMs;
+        };
+
+        GpuEngine(const ShaderPaths& paths, unsigned int imageSlot);
+
+        const char* Name() const noexcept override { return "GPU"; }
+        void Compute(const Frame& frame) override;
+
+        // Only the pixels of regions, for callers that have the rest from elsewhere.
+        // Neither reprojects nor resumes, and the next frame won't either.
+        void Compute(const Frame& frame, const std::vector<Tile>& regions);
+
+        void Validate();
+
+        // The texture bound to imageSlot, nullptr to always dispatch the whole frame.
+        // Sets up its scratch copy on the texture unit numbered imageSlot.
+        void SetReprojectionImage(gl::Texture* image) noexcept { reprojectionImage = image; hasLastFrame = false; }
+        void InvalidateImage() noexcept { hasLastFrame = false; stateValid = false; refineStride = 0; }
+        double LastComputedFraction() const noexcept { return computedFraction; }   // Of the image's pixels
+
+        // R32F texture the caller bound to image unit slot, nullptr to stop writing fractional iterations
+        void SetSmoothImage(gl::Texture* image, unsigned int slot);
+        bool WritesSmooth() const noexcept { return smoothImage != nullptr; }
+
+        // Binds the z state image to image unit stateSlot, set up on the texture unit numbered imageSlot.
+        // Resuming needs a whole frame computed with it on, a pan starts over.
+        void EnableIterationResume(unsigned int stateSlot);
+        void DisableIterationResume() noexcept { iterationResume = false; stateValid = false; }
+        bool IterationResumeEnabled() const noexcept { return iterationResume; }
+        bool LastResumed() const noexcept { return resumed; }
+
+        // Uniform rectangles filled rather than computed, on fp32 frames computed whole.
+        // Resuming needs a frame computed without it.
+        void SetSubdivision(bool enable) noexcept { subdivision = enable; }
+        bool GetSubdivision() const noexcept { return subdivision; }
+        bool SupportsSubdivision() const noexcept { return subdivisionShader != nullptr; }
+        bool LastSubdivided() const noexcept { return subdivided; }
+
+        // At least the coarsest pass runs per frame, and one per Refine() call, however long it takes.
+        // Timing a pass waits for it with glFinish().
+        void SetProgressive(bool enable, double budgetMs) noexcept { progressive = enable; progressiveBudgetMs = budgetMs; }
+        bool GetProgressive() const noexcept { return progressive; }
+        bool RefinePending() const noexcept { return refineStride > 0; }
+        void Refine();
+        int LastStride() const noexcept { return lastStride; }     // Of the finest pass done on the last frame
+
+        // Cardioid and bulb test, then periodicity checking, on every program but the perturbation one.
+        // Much faster inside the set, a little slower along its boundary.
+        void SetInteriorChecks(bool enable);
+        bool GetInteriorChecks() const noexcept { return interiorChecks; }
+
+        // fp64 needs GL 4.0 or GL_ARB_gpu_shader_fp64, and a driver that actually compiles it
+        bool SupportsDouble() const noexcept { return doubleShader != nullptr; }
+        bool SupportsDoubleFloat() const noexcept { return doubleFloatShader != nullptr; }
+
+        // Automatic picks the cheapest precision that resolves the frame
+        void SetAutoPrecision(bool enable) noexcept { autoPrecision = enable; }
+        bool GetAutoPrecision() const noexcept { return autoPrecision; }
+        void SetPrecision(Precision precision) noexcept { this->precision = precision; }
+        Precision LastPrecision() const noexcept { return lastPrecision; }
+        Precision PrecisionFor(const Frame& frame) const noexcept { return pickPrecision(frame); }
+
+        // Times every available program on frame. Blocks on glFinish().
+        // Automatic precision then prefers whichever of double-float and fp64 was faster.
+        BenchmarkResult Benchmark(const Frame& frame, int repeat);
+        const BenchmarkResult& LastBenchmark() const noexcept { return benchmark; }
+
+        static const char* PrecisionName(Precision precision) noexcept;
+
+    private:
+
+        // Squares the first subdivision pass starts from, and the size below which rectangles are computed
+        static constexpr int SUBDIVISION_SIZE = 128;
+        static constexpr int SUBDIVISION_LEAF = 16;
+
+        static constexpr int PROGRESSIVE_STRIDE = 8;    // Of the first pass, halved by each next one
+
+        Precision pickPrecision(const Frame& frame) const noexcept;
+        void dispatch(Precision precision, const Frame& frame, const Tile& region, bool resume = false,
+            int stride = 1, bool skipCoarser = false);
+        void dispatch(Precision precision, const Frame& frame);
+        void setUniform1i(const char* name, int value);
+        void bindState(glm::ivec2 dim);
+        void reproject(Precision precision, const Frame& frame, glm::ivec2 offset);
+        void subdivide(const Frame& frame);
+        void refine(double budgetMs);
+
+        gl::ComputeShader floatShader;
+        std::unique_ptr<gl::ComputeShader> doubleFloatShader;
+        std::unique_ptr<gl::ComputeShader> doubleShader;
+        std::unique_ptr<gl::ComputeShader> subdivisionShader;
+
+        bool autoPrecision = true;
+        Precision precision = Precision::FLOAT;
+        Precision lastPrecision = Precision::FLOAT;
+        BenchmarkResult benchmark = { -1.0, -1.0, -1.0 };
+
+        unsigned int imageSlot;
+        gl::Texture* reprojectionImage = nullptr;
+        gl::Texture* smoothImage = nullptr;
+        gl::Texture scratch;
+        glm::ivec2 scratchDim = { 0, 0 };
+        Frame lastFrame;
+        bool hasLastFrame = false;
+        double computedFraction = 1.0;
+
+        bool iterationResume = false;
+        unsigned int stateSlot = 0;
+        gl::Texture stateZ;
+        glm::ivec2 stateDim = { 0, 0 };
+        bool stateValid = false;    // Holds lastFrame, computed at lastPrecision
+        bool resumed = false;
+
+        bool interiorChecks = false;
+
+        bool progressive = false;
+        double progressiveBudgetMs = 0.0;
+        int refineStride = 0;           // Of the next pass of lastFrame, 0 once it is whole
+        int lastStride = 1;
+        double passPixelMs = 0.0;       // Per pixel, as the last pass took
+
+        bool subdivision = false;
+        bool subdivided = false;
+        gl::ShaderStorageBuffer worklists[2];   // Read and appended to in turn
+        size_t worklistCapacity = 0;            // Rectangles
+    };
+};
+
+#endif // FRACTAL_GPU_ENGINE_H
@@ -0,0 +1,68 @@
+#include "fractal_gpu_escape_stats.h"
+#include "gl_constants.h"
+
+#include <stdio.h>
+
+namespace fractal
+{
+    GpuEscapeStats::GpuEscapeStats(const char* computeShaderPath, unsigned int imageSlot)
+    {
+        computeShader.reset(new gl::ComputeShader(computeShaderPath));
+        if (computeShader->Linked() == false)
+        {
+            computeShader.reset();
+            printf("Escape statistics shader unavailable, automatic iteration only follows the CPU engines\n");
+            return;
+        }
+
+        computeShader->Bind();
+        computeShader->SetUniform1i("uImage", imageSlot);
+    }
+
+    void GpuEscapeStats::Validate()
+    {
+        if (computeShader)
+        {
+            computeShader->Validate();
+        }
+    }
+
+    EscapeStats GpuEscapeStats::Collect(glm::ivec2 dim, int iteration)
+    {
+        EscapeStats stats = {};
+        stats.pixels = (unsigned long long)dim.x * dim.y;
+        if (computeShader == nullptr)
+        {
+            return stats;
+        }
+
+        Counts counts = {};
+        countBuffer.Bind();
+        countBuffer.update(sizeof(counts), &counts);
+        countBuffer.BindBase(0);
+
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        computeShader->Bind();
+        computeShader->SetUniform2i("uImageDim", dim.x, dim.y);
+        computeShader->SetUniform1i("uIteration", iteration);
+        computeShader->compute({
+            (dim.x + gl::LOCAL_WORKGROUP_SIZE - 1) / gl::LOCAL_WORKGROUP_SIZE,
+            (dim.y + gl::LOCAL_WORKGROUP_SIZE - 1) / gl::LOCAL_WORKGROUP_SIZE,
+            1
+        });
+
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        countBuffer.Bind();
+        countBuffer.read(0, sizeof(counts), &counts);
+        countBuffer.Unbind();
+
+        stats.inside = counts.inside;
+        stats.late = counts.late;
+        stats.maxEscape = counts.maxEscape;
+        for (int i = 0; i < EscapeStats::BINS; i++)
+        {
+            stats.histogram[i] = counts.histogram[i];
+        }
+        return stats;
+    }
+};
@@ -0,0 +1,45 @@
+#ifndef FRACTAL_GPU_ESCAPE_STATS_H
+#define FRACTAL_GPU_ESCAPE_STATS_H
+
+#include "fractal_escape_stats.h"
+
+#include "gl_buffers.h"
+#include "gl_shader.h"
+
+#include <memory>
+
+namespace fractal
+{
+    // ReduceEscapeStats() of the R32UI image bound to imageSlot, by res/escape_stats_cs.glsl, for
+    // results that stay on the GPU. Only the counts are read back.
+
+    class GpuEscapeStats
+    {
+    public:
+
+        GpuEscapeStats(const char* computeShaderPath, unsigned int imageSlot);
+
+        bool Supported() const noexcept { return computeShader != nullptr; }
+        void Validate();
+
+        // Pixels [0, dim) of the image. Reading back waits for whatever still writes to it.
+        EscapeStats Collect(glm::ivec2 dim, int iteration);
+
+    private:
+
+        // Layout of the shader's buffer
+        struct Counts
+        {
+            GLuint inside;
+            GLuint late;
+            GLuint maxEscape;
+            GLuint padding;
+            GLuint histogram[EscapeStats::BINS];
+        };
+
+        std::unique_ptr<gl::ComputeShader> computeShader;
+        gl::ShaderStorageBuffer countBuffer;
+    };
+};
+
+#endif // FRACTAL_GPU_ESCAPE_STATS_H
@@ -0,0 +1,148 @@
+#include "fractal_gpu_perturbation_engine.h"
+#include "gl_constants.h"
+
+#include <stdio.h>
+
+namespace fractal
+{
+    GpuPerturbationEngine::GpuPerturbationEngine(const char* computeShaderPath, unsigned int imageSlot, unsigned int glitchMaskSlot):
+        glitchMask(gl::TextureTarget::TEX2D, gl::PixelFormat::R8UI, gl::TextureWrap::SMEAR),
+        glitchMaskSlot(glitchMaskSlot)
+    {
+        if (GLEW_VERSION_4_0 || GLEW_ARB_gpu_shader_fp64)
+        {
+            computeShader.reset(new gl::ComputeShader(computeShaderPath));
+            if (computeShader->Linked())
+            {
+                computeShader->Bind();
+                computeShader->SetUniform1i("uImage", imageSlot);
+                computeShader->SetUniform1i("uGlitchMask", glitchMaskSlot);
+            }
+            else
+            {
+                computeShader.reset();
+            }
+        }
+
+        if (computeShader == nullptr)
+        {
+            printf("fp64 perturbation shader unavailable, deep zoom runs on the CPU\n");
+        }
+    }
+
+    void GpuPerturbationEngine::Validate()
+    {
+        if (computeShader)
+        {
+            computeShader->Validate();
+        }
+    }
+
+    void GpuPerturbationEngine::Compute(const Frame& frame)
+    {
+        if (computeShader == nullptr)
+        {
+            return;
+        }
+
+        // One mask entry per pixel, telling the next reference what to redo
+        if (frame.imageDim != glitchMaskDim)
+        {
+            glitchMask.Bind(glitchMaskSlot);
+            glitchMask.UpdatePixelData(frame.imageDim, nullptr);
+            glitchMaskDim = frame.imageDim;
+        }
+        glitchMask.BindToImageUnit(glitchMaskSlot, gl::ImageAccess::READ_WRITE);
+
+        const unsigned int iteration = (unsigned int)frame.iteration;
+        const glm::dvec2 dim = frame.imageDim;
+        const glm::dvec2 range = { frame.rangeRect.z, frame.rangeRect.w };
+        const int limbs = Fixed::LimbsFor(glm::min(range.x / dim.x, range.y / dim.y));
+
+        computeShader->Bind();
+        computeShader->SetUniform2f("uImageDim", (float)frame.imageDim.x, (float)frame.imageDim.y);
+        computeShader->SetUniform1i("uIteration", frame.iteration);
+        orbitBuffer.BindBase(0);
+        glitchBuffer.BindBase(1);
+
+        glm::dvec2 referenceDelta = { 0.0, 0.0 };
+        referenceCount = 0;
+
+        for (unsigned int reference = 0; reference < maxReferences; reference++)
+        {
+            const bool lastReference = (reference + 1 == maxReferences);
+
+            orbit.Compute(
+                frame.centerX + Fixed(referenceDelta.x, limbs),
+                frame.centerY + Fixed(referenceDelta.y, limbs),
+                iteration
+            );
+
+            // Skip as far as the series holds on the probe grid
+            const glm::dvec2 deltaOrigin = -range / 2.0 - referenceDelta;
+            glm::dvec2 probes[(PROBE_GRID + 1) * (PROBE_GRID + 1)];
+            double radius = 0.0;
+            for (int i = 0; i <= PROBE_GRID; i++)
+            {
+                for (int j = 0; j <= PROBE_GRID; j++)
+                {
+                    const glm::dvec2 probe = deltaOrigin + range * glm::dvec2(j, i) / (double)PROBE_GRID;
+                    probes[i * (PROBE_GRID + 1) + j] = probe;
+                    radius = glm::max(radius, glm::length(probe));
+                }
+            }
+            series.Compute(orbit, seriesApproximation ? radius : 0.0, seriesApproximation ? iteration : 1);
+            const unsigned int passSkip = series.ValidSkip(orbit, probes, (PROBE_GRID + 1) * (PROBE_GRID + 1), series.MaxSkip());
+            if (reference == 0)
+            {
+                skip = passSkip;
+            }
+
+            const SeriesApproximation::Terms& terms = series.TermsAt(passSkip);
+            computeShader->SetUniform1i("uSkipIteration", (int)passSkip);
+            computeShader->SetUniform2d("uSeriesA", terms.a.x, terms.a.y);
+            computeShader->SetUniform2d("uSeriesB", terms.b.x, terms.b.y);
+            computeShader->SetUniform2d("uSeriesC", terms.c.x, terms.c.y);
+
+            orbitBuffer.Bind();
+            orbitBuffer.update(orbit.Length() * sizeof(glm::dvec2), orbit.Points().data());
+
+            const GLuint glitchReset[3] = { 0, 0, 0xFFFFFFFFu };
+            glitchBuffer.Bind();
+            glitchBuffer.update(sizeof(glitchReset), glitchReset);
+
+            computeShader->SetUniform4d("uDeltaRect", deltaOrigin.x, deltaOrigin.y, range.x, range.y);
+            computeShader->SetUniform1i("uOrbitLength", (int)orbit.Length());
+            computeShader->SetUniform1i("uGlitchedOnly", reference > 0);
+            computeShader->SetUniform1i("uDetectGlitch", lastReference == false);
+            computeShader->compute({
+                (frame.imageDim.x + gl::LOCAL_WORKGROUP_SIZE - 1) / gl::LOCAL_WORKGROUP_SIZE,
+                (frame.imageDim.y + gl::LOCAL_WORKGROUP_SIZE - 1) / gl::LOCAL_WORKGROUP_SIZE,
+                1
+            });
+            referenceCount++;
+
+            if (lastReference)
+            {
+                break;
+            }
+
+            // Small readback, but it waits for the pass to finish
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+            GLuint glitchInfo[3];
+            glitchBuffer.Bind();
+            glitchBuffer.read(0, sizeof(glitchInfo), glitchInfo);
+            if (glitchInfo[0] == 0)
+            {
+                break;
+            }
+
+            const int x = (int)(glitchInfo[1] % (GLuint)frame.imageDim.x);
+            const int y = (int)(glitchInfo[1] / (GLuint)frame.imageDim.x);
+            referenceDelta = -range / 2.0 + range * glm::dvec2(x, y) / dim;
+        }
+
+        glitchBuffer.Unbind();
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    }
+};
@@ -0,0 +1,63 @@
+#ifndef FRACTAL_GPU_PERTURBATION_ENGINE_H
+#define FRACTAL_GPU_PERTURBATION_ENGINE_H
+
+#include "fractal_engine.h"
+#include "fractal_reference_orbit.h"
+#include "fractal_series.h"
+
+#include "gl_buffers.h"
+#include "gl_shader.h"
+#include "gl_texture.h"
+
+#include <memory>
+
+namespace fractal
+{
+    // Deep zoom on the GPU: runs res/mandelbrot_perturbation_cs.glsl with the reference orbit in a
+    // shader storage buffer. After each pass the host reads back how many pixels glitched, and redoes
+    // only those against a new reference at one of them. Needs fp64 and a Frame from MakeFrame().
+    // The result goes to the texture bound to imageSlot, like GpuEngine.
+    //
+    // The whole dispatch shares one series skip, the smallest that probes on a coarse grid of
+    // tiles over the frame allowed.
+
+    class GpuPerturbationEngine : public FractalEngine
+    {
+    public:
+
+        GpuPerturbationEngine(const char* computeShaderPath, unsigned int imageSlot, unsigned int glitchMaskSlot);
+
+        const char* Name() const noexcept override { return "GPU Perturbation"; }
+        void Compute(const Frame& frame) override;
+
+        bool Supported() const noexcept { return computeShader != nullptr; }
+        void Validate();
+
+        void SetMaxReferences(unsigned int count) noexcept { maxReferences = (count == 0) ? 1 : count; }
+        unsigned int LastReferenceCount() const noexcept { return referenceCount; }
+
+        void SetSeriesApproximation(bool enable) noexcept { seriesApproximation = enable; }
+        bool GetSeriesApproximation() const noexcept { return seriesApproximation; }
+        unsigned int LastSkip() const noexcept { return skip; }     // Of the first reference
+
+    private:
+
+        static constexpr int PROBE_GRID = 8;    // Tiles per side, probed at their corners
+
+        std::unique_ptr<gl::ComputeShader> computeShader;
+        gl::ShaderStorageBuffer orbitBuffer;
+        gl::ShaderStorageBuffer glitchBuffer;
+        gl::Texture glitchMask;
+        glm::ivec2 glitchMaskDim = { 0, 0 };
+        unsigned int glitchMaskSlot;
+
+        ReferenceOrbit orbit;
+        SeriesApproximation series;
+        unsigned int maxReferences = 8;
+        unsigned int referenceCount = 0;
+        bool seriesApproximation = true;
+        unsigned int skip = 0;
+    };
+};
+
+#endif // FRACTAL_GPU_PERTURBATION_ENGINE_H
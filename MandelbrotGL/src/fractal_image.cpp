@@ -0,0 +1,325 @@
+#include "fractal_image.h"
+#include "fractal_palette.h"
+
+#include <ctype.h>
+#include <string.h>
+
+namespace fractal
+{
+    static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    constexpr size_t DEFLATE_STORED_MAX = 65535;
+    constexpr uint32_t ADLER_MOD = 65521;
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+    {
+        static const struct Table
+        {
+            uint32_t entries[256];
+
+            Table()
+            {
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++)
+                    {
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    }
+                    entries[n] = c;
+                }
+            }
+        } table;
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    static uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler)
+    {
+        uint32_t a = adler & 0xFFFF;
+        uint32_t b = adler >> 16;
+        while (size > 0)
+        {
+            // Longest run before b can overflow 32 bits
+            const size_t run = (size < 5552) ? size : 5552;
+            for (size_t i = 0; i < run; i++)
+            {
+                a += data[i];
+                b += a;
+            }
+            a %= ADLER_MOD;
+            b %= ADLER_MOD;
+            data += run;
+            size -= run;
+        }
+        return (b << 16) | a;
+    }
+
+    static void putBigEndian(uint8_t* out, uint32_t value)
+    {
+        out[0] = (uint8_t)(value >> 24);
+        out[1] = (uint8_t)(value >> 16);
+        out[2] = (uint8_t)(value >> 8);
+        out[3] = (uint8_t)value;
+    }
+
+    // Extensions match in any case, as "PNG" or "Tiff"
+    static bool extensionIs(const char* dot, const char* extension) noexcept
+    {
+        for (; *dot && *extension; dot++, extension++)
+        {
+            if (tolower((unsigned char)*dot) != *extension) return false;
+        }
+        return *dot == *extension;
+    }
+
+    ImageFormat FormatFromPath(const char* path) noexcept
+    {
+        const char* dot = strrchr(path, '.');
+        if (dot == nullptr) return ImageFormat::RAW;
+        if (extensionIs(dot, ".png")) return ImageFormat::PNG;
+        if (extensionIs(dot, ".ppm")) return ImageFormat::PPM;
+        if (extensionIs(dot, ".tif") || extensionIs(dot, ".tiff")) return ImageFormat::TIFF;
+        return ImageFormat::RAW;
+    }
+
+    ImageWriter::ImageWriter(const char* path, ImageFormat format, glm::ivec2 dim, int iteration):
+        file(fopen(path, "wb")),
+        format(format),
+        dim(dim),
+        iteration(iteration)
+    {
+        if (file == nullptr)
+        {
+            printf("Error: can't open %s for writing\n", path);
+            return;
+        }
+        if (format == ImageFormat::TIFF)
+        {
+            printf("Error: TIFF is only written in tiles\n");
+            failed = true;
+            return;
+        }
+
+        const size_t pixelSize = (format == ImageFormat::RAW) ? 4 : 3;
+        row.resize(1 + (size_t)dim.x * pixelSize);
+
+        switch (format)
+        {
+        case ImageFormat::PNG:
+        {
+            uint8_t header[13];
+            putBigEndian(header, (uint32_t)dim.x);
+            putBigEndian(header + 4, (uint32_t)dim.y);
+            header[8] = 8;      // Bits per channel
+            header[9] = 2;      // RGB
+            header[10] = 0;     // Deflate
+            header[11] = 0;     // Adaptive filtering, every row uses "none"
+            header[12] = 0;     // Not interlaced
+
+            writeBytes(PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+            writePngChunk("IHDR", header, sizeof(header));
+            break;
+        }
+
+        case ImageFormat::PPM:
+            fprintf(file, "P6\n%d %d\n255\n", dim.x, dim.y);
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    ImageWriter::~ImageWriter()
+    {
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+
+    void ImageWriter::WriteRow(const uint32_t* iterations)
+    {
+        if (Good() == false || rowsWritten >= dim.y)
+        {
+            failed = true;
+            return;
+        }
+
+        uint8_t* out = row.data() + 1;
+        if (format == ImageFormat::RAW)
+        {
+            for (int x = 0; x < dim.x; x++, out += 4)
+            {
+                out[0] = (uint8_t)iterations[x];
+                out[1] = (uint8_t)(iterations[x] >> 8);
+                out[2] = (uint8_t)(iterations[x] >> 16);
+                out[3] = (uint8_t)(iterations[x] >> 24);
+            }
+        }
+        else
+        {
+            for (int x = 0; x < dim.x; x++, out += 3)
+            {
+                const glm::u8vec3 color = PaletteColor(PaletteShade(iterations[x], iteration));
+                out[0] = color.r;
+                out[1] = color.g;
+                out[2] = color.b;
+            }
+        }
+
+        writeRow();
+    }
+
+    void ImageWriter::WriteColorRow(const uint8_t* rgb)
+    {
+        if (Good() == false || rowsWritten >= dim.y || format == ImageFormat::RAW)
+        {
+            failed = true;
+            return;
+        }
+
+        memcpy(row.data() + 1, rgb, (size_t)dim.x * 3);
+        writeRow();
+    }
+
+    bool ImageWriter::Close()
+    {
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        if (rowsWritten != dim.y)
+        {
+            printf("Error: image closed with %d of its %d rows\n", rowsWritten, dim.y);
+            failed = true;
+        }
+        else if (format == ImageFormat::PNG)
+        {
+            writePngChunk("IEND", nullptr, 0);
+        }
+
+        failed |= (fclose(file) != 0);
+        file = nullptr;
+        return failed == false;
+    }
+
+    void ImageWriter::writeRow()
+    {
+        if (format == ImageFormat::PNG)
+        {
+            writePngRow();
+        }
+        else
+        {
+            writeBytes(row.data() + 1, row.size() - 1);
+        }
+        rowsWritten++;
+    }
+
+    void ImageWriter::writeBytes(const void* data, size_t size)
+    {
+        failed |= (fwrite(data, 1, size, file) != size);
+    }
+
+    void ImageWriter::writePngChunk(const char type[4], const uint8_t* data, size_t size)
+    {
+        uint8_t length[4], crc[4];
+        putBigEndian(length, (uint32_t)size);
+        putBigEndian(crc, crc32(data, size, crc32((const uint8_t*)type, 4)));
+
+        writeBytes(length, 4);
+        writeBytes(type, 4);
+        writeBytes(data, size);
+        writeBytes(crc, 4);
+    }
+
+    // Row bytes as stored deflate blocks, framed by the zlib header on the first row and the
+    // Adler-32 of everything on the last
+
+    void ImageWriter::writePngRow()
+    {
+        row[0] = 0;     // Filter type none
+        adler = adler32(row.data(), row.size(), adler);
+
+        const bool lastRow = (rowsWritten == dim.y - 1);
+        chunk.clear();
+        if (rowsWritten == 0)
+        {
+            chunk.push_back(0x78);  // Deflate, 32K window
+            chunk.push_back(0x01);  // No preset dictionary, fastest, checksum of the two bytes
+        }
+
+        for (size_t offset = 0; offset < row.size(); offset += DEFLATE_STORED_MAX)
+        {
+            const size_t size = glm::min(row.size() - offset, DEFLATE_STORED_MAX);
+            const bool lastBlock = lastRow && offset + size == row.size();
+            const uint8_t header[5] = {
+                (uint8_t)(lastBlock ? 1 : 0),
+                (uint8_t)size, (uint8_t)(size >> 8),
+                (uint8_t)~size, (uint8_t)(~size >> 8)
+            };
+            chunk.insert(chunk.end(), header, header + 5);
+            chunk.insert(chunk.end(), row.begin() + offset, row.begin() + offset + size);
+        }
+
+        if (lastRow)
+        {
+            uint8_t checksum[4];
+            putBigEndian(checksum, adler);
+            chunk.insert(chunk.end(), checksum, checksum + 4);
+        }
+
+        writePngChunk("IDAT", chunk.data(), chunk.size());
+    }
+
+    bool WriteImage(const char* path, ImageFormat format, const uint32_t* pixels, glm::ivec2 dim, int iteration)
+    {
+        ImageWriter writer(path, format, dim, iteration);
+        for (int y = dim.y - 1; y >= 0 && writer.Good(); y--)
+        {
+            writer.WriteRow(pixels + (size_t)y * dim.x);
+        }
+        return writer.Close();
+    }
+
+    bool WriteYuvFrame(FILE* file, const uint8_t* rgb, glm::ivec2 dim)
+    {
+        std::vector<uint8_t> planes((size_t)dim.x * dim.y * 3 / 2);
+        uint8_t* luma = planes.data();
+        uint8_t* cb = luma + (size_t)dim.x * dim.y;
+        uint8_t* cr = cb + (size_t)dim.x * dim.y / 4;
+
+        for (int y = 0; y < dim.y; y++)
+        {
+            for (int x = 0; x < dim.x; x++)
+            {
+                const uint8_t* in = rgb + ((size_t)y * dim.x + x) * 3;
+                luma[(size_t)y * dim.x + x] = (uint8_t)(16.5f + (65.481f * in[0] + 128.553f * in[1] + 24.966f * in[2]) / 255.0f);
+            }
+        }
+
+        // Chroma of each 2x2 block's average color
+        for (int y = 0; y < dim.y / 2; y++)
+        {
+            for (int x = 0; x < dim.x / 2; x++)
+            {
+                const uint8_t* a = rgb + ((size_t)(2 * y) * dim.x + 2 * x) * 3;
+                const uint8_t* b = a + (size_t)dim.x * 3;
+                const glm::vec3 color = (glm::vec3(a[0], a[1], a[2]) + glm::vec3(a[3], a[4], a[5]) +
+                    glm::vec3(b[0], b[1], b[2]) + glm::vec3(b[3], b[4], b[5])) / 4.0f;
+
+                cb[(size_t)y * (dim.x / 2) + x] = (uint8_t)(128.5f + (-37.797f * color.r - 74.203f * color.g + 112.0f * color.b) / 255.0f);
+                cr[(size_t)y * (dim.x / 2) + x] = (uint8_t)(128.5f + (112.0f * color.r - 93.786f * color.g - 18.214f * color.b) / 255.0f);
+            }
+        }
+
+        return fwrite(planes.data(), 1, planes.size(), file) == planes.size();
+    }
+};
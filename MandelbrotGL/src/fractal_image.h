@@ -0,0 +1,77 @@
+#ifndef FRACTAL_IMAGE_H
+#define FRACTAL_IMAGE_H
+
+#include "glm.hpp"
+
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace fractal
+{
+    enum class ImageFormat
+    {
+        PNG,    // 8 bit RGB through the palette
+        PPM,    // Same colors, binary P6
+        RAW,    // Escape iterations as little endian uint32, 0 if inside, no header
+        TIFF    // BigTIFF of palette colors in tiles, only through TiledImageWriter
+    };
+
+    // From the extension in any case, ".png", ".ppm", ".tif", ".tiff" or anything else for RAW
+    ImageFormat FormatFromPath(const char* path) noexcept;
+
+    // Streams an image to a file one row at a time, top row first, so that callers computing
+    // in strips never hold the whole picture. Rows are escape iterations as the engines give
+    // them; colored ones go through PaletteColor() as the fragment shader would at iteration.
+    //
+    // The PNG is deflate in stored blocks, one IDAT per row: bigger than zlib would make it,
+    // but it needs no dependency and costs nothing to write.
+
+    class ImageWriter
+    {
+    public:
+
+        ImageWriter(const char* path, ImageFormat format, glm::ivec2 dim, int iteration);
+        ~ImageWriter();
+
+        ImageWriter(const ImageWriter&) = delete;
+        ImageWriter(ImageWriter&&) = delete;
+        ImageWriter& operator=(const ImageWriter&) = delete;
+        ImageWriter& operator=(ImageWriter&&) = delete;
+
+        bool Good() const noexcept { return file != nullptr && failed == false; }
+
+        void WriteRow(const uint32_t* iterations);
+        void WriteColorRow(const uint8_t* rgb);     // Already colored, PNG and PPM only
+
+        // False if a write failed or rows are missing
+        bool Close();
+
+    private:
+
+        void writeRow();
+        void writeBytes(const void* data, size_t size);
+        void writePngChunk(const char type[4], const uint8_t* data, size_t size);
+        void writePngRow();
+
+        FILE* file;
+        ImageFormat format;
+        glm::ivec2 dim;
+        int iteration;
+        int rowsWritten = 0;
+        bool failed = false;
+
+        std::vector<uint8_t> row;       // Encoded, with room for the PNG filter byte in front
+        std::vector<uint8_t> chunk;     // IDAT payload of the current PNG row
+        uint32_t adler = 1;
+    };
+
+    // A whole engine image, bottom row first as in CpuEngine::Pixels()
+    bool WriteImage(const char* path, ImageFormat format, const uint32_t* pixels, glm::ivec2 dim, int iteration);
+
+    // One frame of a raw yuv420p (I420) stream from RGB rows, top row first, in BT.601 limited range:
+    // what "ffmpeg -f rawvideo -pix_fmt yuv420p -s WxH -i -" reads. dim has to be even.
+    bool WriteYuvFrame(FILE* file, const uint8_t* rgb, glm::ivec2 dim);
+};
+
+#endif // FRACTAL_IMAGE_H
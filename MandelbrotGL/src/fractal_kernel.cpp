@@ -0,0 +1,132 @@
+#include "fractal_kernel.h"
+
+#if FRACTAL_KERNEL_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#endif
+
+namespace fractal
+{
+    // Detection
+
+    Isa DetectIsa() noexcept
+    {
+#if FRACTAL_KERNEL_X86
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        const bool sse2 = (info[3] & (1 << 26)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+
+        // The OS has to save the wider registers on context switch, too
+        unsigned long long xcr0 = (osxsave) ? _xgetbv(0) : 0;
+        const bool osYmm = (xcr0 & 0x06) == 0x06;
+        const bool osZmm = (xcr0 & 0xE6) == 0xE6;
+
+        bool avx2 = false;
+        bool avx512 = false;
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+            avx512 = (info[1] & (1 << 16)) != 0;
+        }
+
+        if (avx512 && osZmm) return Isa::AVX512;
+        if (avx2 && avx && osYmm) return Isa::AVX2;
+        if (sse2) return Isa::SSE2;
+#else
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+        if (__builtin_cpu_supports("sse2")) return Isa::SSE2;
+#endif
+#endif
+        return Isa::SCALAR;
+    }
+
+    const char* IsaName(Isa isa) noexcept
+    {
+        switch (isa)
+        {
+        case Isa::SCALAR: return "Scalar";
+        case Isa::SSE2: return "SSE2";
+        case Isa::AVX2: return "AVX2";
+        case Isa::AVX512: return "AVX-512";
+        }
+        return "";
+    }
+
+    unsigned int IsaLaneCount(Isa isa, Precision precision) noexcept
+    {
+        const unsigned int bits = [isa]()
+        {
+            switch (isa)
+            {
+            case Isa::SSE2: return 128;
+            case Isa::AVX2: return 256;
+            case Isa::AVX512: return 512;
+            default: return 0;
+            }
+        }();
+
+        if (bits == 0)
+        {
+            return 1;
+        }
+        return bits / ((precision == Precision::FLOAT) ? 32 : 64);
+    }
+
+    RowKernel GetRowKernel(Isa isa, Precision precision) noexcept
+    {
+        static const Isa supported = DetectIsa();
+        if ((int)isa > (int)supported)
+        {
+            isa = supported;
+        }
+
+        const bool isFloat = (precision == Precision::FLOAT);
+        switch (isa)
+        {
+#if FRACTAL_KERNEL_X86
+        case Isa::SSE2: return (isFloat) ? &RowKernelSse2Float : &RowKernelSse2Double;
+        case Isa::AVX2: return (isFloat) ? &RowKernelAvx2Float : &RowKernelAvx2Double;
+        case Isa::AVX512: return (isFloat) ? &RowKernelAvx512Float : &RowKernelAvx512Double;
+#endif
+        default: return (isFloat) ? &RowKernelScalarFloat : &RowKernelScalarDouble;
+        }
+    }
+
+    // Scalar kernels
+
+    template<typename T>
+    static void rowKernelScalar(const RowSpan& span, uint32_t* out)
+    {
+        const T rangeX = (T)span.rangeX;
+        const T rangeW = (T)span.rangeW;
+        const T dimX = (T)span.dimX;
+        const T cy = (T)span.rangeY + (T)span.rangeH * (T)span.y / (T)span.dimY;
+
+        for (int i = 0; i < span.count; i++)
+        {
+            T cx = rangeX + rangeW * (T)(span.x + i) / dimX;
+            out[i] = EscapeTime<T>(cx, cy, span.iteration, span.interiorChecks);
+        }
+    }
+
+    void RowKernelScalarFloat(const RowSpan& span, uint32_t* out)
+    {
+        rowKernelScalar<float>(span, out);
+    }
+
+    void RowKernelScalarDouble(const RowSpan& span, uint32_t* out)
+    {
+        rowKernelScalar<double>(span, out);
+    }
+};
@@ -0,0 +1,134 @@
+#ifndef FRACTAL_KERNEL_H
+#define FRACTAL_KERNEL_H
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define FRACTAL_KERNEL_X86 1
+#else
+#define FRACTAL_KERNEL_X86 0
+#endif
+
+namespace fractal
+{
+    // Interior checks, optional in every kernel. A point in the main cardioid or the period 2 bulb
+    // never escapes, which a closed form tells; for the others the orbit is compared against the
+    // point it reached at the last power of two steps (Brent), and coming back to it within
+    // PERIOD_EPSILON means it settled on a cycle that won't escape either.
+
+    constexpr float PERIOD_EPSILON_FLOAT = 1e-6f;
+    constexpr double PERIOD_EPSILON_DOUBLE = 1e-12;
+
+    template<typename T>
+    inline bool InMainComponents(T cx, T cy) noexcept
+    {
+        const T x = cx - T(0.25);
+        const T y2 = cy * cy;
+        const T q = x * x + y2;
+        if (q * (q + x) <= T(0.25) * y2)
+        {
+            return true;
+        }
+        return (cx + T(1)) * (cx + T(1)) + y2 <= T(0.0625);
+    }
+
+    // Escape time loop of res/mandelbrot_cs.glsl for one point, with "reached uIteration" mapped to 0
+
+    template<typename T>
+    inline unsigned int EscapeTime(T cx, T cy, unsigned int iteration, bool interiorChecks = false) noexcept
+    {
+        if (interiorChecks && InMainComponents(cx, cy))
+        {
+            return 0;
+        }
+
+        const T epsilon = (sizeof(T) == sizeof(float)) ? T(PERIOD_EPSILON_FLOAT) : T(PERIOD_EPSILON_DOUBLE);
+        T zx = 0;
+        T zy = 0;
+        T savedX = 0;
+        T savedY = 0;
+
+        unsigned int it = 0;
+        for (; it < iteration && (zx * zx + zy * zy < T(2) * T(2)); it++)
+        {
+            zx += cx;
+            zy += cy;
+
+            T x = zx * zx - zy * zy;
+            zy = T(2) * zx * zy;
+            zx = x;
+
+            if (interiorChecks)
+            {
+                T dx = zx - savedX;
+                T dy = zy - savedY;
+                if (dx < epsilon && dx > -epsilon && dy < epsilon && dy > -epsilon)
+                {
+                    return 0;
+                }
+                if ((it & (it + 1)) == 0)
+                {
+                    savedX = zx;
+                    savedY = zy;
+                }
+            }
+        }
+
+        if (it == iteration)
+        {
+            it = 0;
+        }
+
+        return it;
+    }
+
+    // Kernels
+
+    enum class Isa
+    {
+        SCALAR, SSE2, AVX2, AVX512
+    };
+
+    enum class Precision
+    {
+        FLOAT,
+        DOUBLE,
+        DOUBLE_FLOAT    // Pair of floats, only used by the GPU. CPU kernels run it as DOUBLE
+    };
+
+    // One run of pixels on a row. Point of pixel (x, y) is
+    // (rangeX + rangeW * x / dimX, rangeY + rangeH * y / dimY), evaluated in the kernel's precision.
+
+    struct RowSpan
+    {
+        double rangeX, rangeY, rangeW, rangeH;  // uRangeRect
+        double dimX, dimY;                      // uImageDim
+        int x, y;                               // First pixel
+        int count;
+        unsigned int iteration;                 // uIteration, at most 2^24 for float kernels
+        bool interiorChecks;                    // Cardioid and bulb test, then periodicity checking
+    };
+
+    typedef void (*RowKernel)(const RowSpan& span, uint32_t* out);
+
+    Isa DetectIsa() noexcept;
+    const char* IsaName(Isa isa) noexcept;
+    unsigned int IsaLaneCount(Isa isa, Precision precision) noexcept;
+
+    // Falls back to the widest supported kernel if isa isn't supported by the running CPU
+    RowKernel GetRowKernel(Isa isa, Precision precision) noexcept;
+
+    void RowKernelScalarFloat(const RowSpan& span, uint32_t* out);
+    void RowKernelScalarDouble(const RowSpan& span, uint32_t* out);
+
+#if FRACTAL_KERNEL_X86
+    void RowKernelSse2Float(const RowSpan& span, uint32_t* out);
+    void RowKernelSse2Double(const RowSpan& span, uint32_t* out);
+    void RowKernelAvx2Float(const RowSpan& span, uint32_t* out);
+    void RowKernelAvx2Double(const RowSpan& span, uint32_t* out);
+    void RowKernelAvx512Float(const RowSpan& span, uint32_t* out);
+    void RowKernelAvx512Double(const RowSpan& span, uint32_t* out);
+#endif
+};
+
+#endif // FRACTAL_KERNEL_H
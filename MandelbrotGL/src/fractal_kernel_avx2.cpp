@@ -0,0 +1,214 @@
+#include "fractal_kernel.h"
+
+// Only called after GetRowKernel() checked the CPU. Nothing from the standard library is
+// included here, so no inline function compiled for AVX2 can leak into other translation units.
+// "fma" is deliberately not enabled, so mul + add isn't contracted and results stay equal to the scalar kernel.
+
+#if FRACTAL_KERNEL_X86
+
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define FRACTAL_TARGET __attribute__((target("avx2")))
+#else
+#define FRACTAL_TARGET
+#endif
+
+namespace fractal
+{
+    // 8 pixels per step
+
+    FRACTAL_TARGET void RowKernelAvx2Float(const RowSpan& span, uint32_t* out)
+    {
+        const __m256 rangeX = _mm256_set1_ps((float)span.rangeX);
+        const __m256 rangeW = _mm256_set1_ps((float)span.rangeW);
+        const __m256 dimX = _mm256_set1_ps((float)span.dimX);
+        const __m256 cy = _mm256_set1_ps((float)span.rangeY + (float)span.rangeH * (float)span.y / (float)span.dimY);
+
+        const __m256 lane = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 four = _mm256_set1_ps(4.0f);
+        const __m256 quarter = _mm256_set1_ps(0.25f);
+        const __m256 sixteenth = _mm256_set1_ps(0.0625f);
+        const __m256 epsilon = _mm256_set1_ps(PERIOD_EPSILON_FLOAT);
+        const __m256 signBit = _mm256_set1_ps(-0.0f);
+        const __m256 iterationReached = _mm256_set1_ps((float)span.iteration);
+        const __m256i iteration = _mm256_set1_epi32((int)span.iteration);
+
+        for (int i = 0; i < span.count; i += 8)
+        {
+            __m256 x = _mm256_add_ps(_mm256_set1_ps((float)(span.x + i)), lane);
+            __m256 cx = _mm256_add_ps(rangeX, _mm256_div_ps(_mm256_mul_ps(rangeW, x), dimX));
+
+            __m256 zx = _mm256_setzero_ps();
+            __m256 zy = _mm256_setzero_ps();
+            __m256 it = _mm256_setzero_ps();
+            __m256 active = _mm256_cmp_ps(zx, zx, _CMP_EQ_OQ);
+
+            // Main cardioid and period 2 bulb: inside, as if they had run all the iterations
+            if (span.interiorChecks)
+            {
+                __m256 qx = _mm256_sub_ps(cx, quarter);
+                __m256 y2 = _mm256_mul_ps(cy, cy);
+                __m256 q = _mm256_add_ps(_mm256_mul_ps(qx, qx), y2);
+                __m256 cardioid = _mm256_cmp_ps(_mm256_mul_ps(q, _mm256_add_ps(q, qx)), _mm256_mul_ps(quarter, y2), _CMP_LE_OQ);
+                __m256 bx = _mm256_add_ps(cx, one);
+                __m256 bulb = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(bx, bx), y2), sixteenth, _CMP_LE_OQ);
+                __m256 inside = _mm256_or_ps(cardioid, bulb);
+                it = _mm256_and_ps(inside, iterationReached);
+                active = _mm256_andnot_ps(inside, active);
+            }
+            __m256 savedX = zx;
+            __m256 savedY = zy;
+
+            for (unsigned int k = 0; k < span.iteration; k++)
+            {
+                __m256 magnitude = _mm256_add_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+                active = _mm256_and_ps(active, _mm256_cmp_ps(magnitude, four, _CMP_LT_OQ));
+                if (_mm256_movemask_ps(active) == 0)
+                    break;
+
+                it = _mm256_add_ps(it, _mm256_and_ps(active, one));
+
+                zx = _mm256_add_ps(zx, cx);
+                zy = _mm256_add_ps(zy, cy);
+                __m256 zx2 = _mm256_sub_ps(_mm256_mul_ps(zx, zx), _mm256_mul_ps(zy, zy));
+                zy = _mm256_mul_ps(_mm256_mul_ps(two, zx), zy);
+                zx = zx2;
+
+                // Back to the point saved at the last power of two steps: on a cycle, inside too
+                if (span.interiorChecks)
+                {
+                    __m256 dx = _mm256_andnot_ps(signBit, _mm256_sub_ps(zx, savedX));
+                    __m256 dy = _mm256_andnot_ps(signBit, _mm256_sub_ps(zy, savedY));
+                    __m256 periodic = _mm256_and_ps(active, _mm256_and_ps(_mm256_cmp_ps(dx, epsilon, _CMP_LT_OQ), _mm256_cmp_ps(dy, epsilon, _CMP_LT_OQ)));
+                    if (_mm256_movemask_ps(periodic) != 0)
+                    {
+                        it = _mm256_blendv_ps(it, iterationReached, periodic);
+                        active = _mm256_andnot_ps(periodic, active);
+                    }
+                    if ((k & (k + 1)) == 0)
+                    {
+                        savedX = zx;
+                        savedY = zy;
+                    }
+                }
+            }
+
+            __m256i result = _mm256_cvttps_epi32(it);
+            result = _mm256_andnot_si256(_mm256_cmpeq_epi32(result, iteration), result);
+
+            if (span.count - i >= 8)
+            {
+                _mm256_storeu_si256((__m256i*)(out + i), result);
+            }
+            else
+            {
+                alignas(32) uint32_t tail[8];
+                _mm256_store_si256((__m256i*)tail, result);
+                for (int j = 0; j < span.count - i; j++)
+                    out[i + j] = tail[j];
+            }
+        }
+    }
+
+    // 4 pixels per step
+
+    FRACTAL_TARGET void RowKernelAvx2Double(const RowSpan& span, uint32_t* out)
+    {
+        const __m256d rangeX = _mm256_set1_pd(span.rangeX);
+        const __m256d rangeW = _mm256_set1_pd(span.rangeW);
+        const __m256d dimX = _mm256_set1_pd(span.dimX);
+        const __m256d cy = _mm256_set1_pd(span.rangeY + span.rangeH * (double)span.y / span.dimY);
+
+        const __m256d lane = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d two = _mm256_set1_pd(2.0);
+        const __m256d four = _mm256_set1_pd(4.0);
+        const __m256d quarter = _mm256_set1_pd(0.25);
+        const __m256d sixteenth = _mm256_set1_pd(0.0625);
+        const __m256d epsilon = _mm256_set1_pd(PERIOD_EPSILON_DOUBLE);
+        const __m256d signBit = _mm256_set1_pd(-0.0);
+        const __m256d iterationReached = _mm256_set1_pd((double)span.iteration);
+        const __m128i iteration = _mm_set1_epi32((int)span.iteration);
+
+        for (int i = 0; i < span.count; i += 4)
+        {
+            __m256d x = _mm256_add_pd(_mm256_set1_pd((double)(span.x + i)), lane);
+            __m256d cx = _mm256_add_pd(rangeX, _mm256_div_pd(_mm256_mul_pd(rangeW, x), dimX));
+
+            __m256d zx = _mm256_setzero_pd();
+            __m256d zy = _mm256_setzero_pd();
+            __m256d it = _mm256_setzero_pd();
+            __m256d active = _mm256_cmp_pd(zx, zx, _CMP_EQ_OQ);
+
+            // Main cardioid and period 2 bulb: inside, as if they had run all the iterations
+            if (span.interiorChecks)
+            {
+                __m256d qx = _mm256_sub_pd(cx, quarter);
+                __m256d y2 = _mm256_mul_pd(cy, cy);
+                __m256d q = _mm256_add_pd(_mm256_mul_pd(qx, qx), y2);
+                __m256d cardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, qx)), _mm256_mul_pd(quarter, y2), _CMP_LE_OQ);
+                __m256d bx = _mm256_add_pd(cx, one);
+                __m256d bulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(bx, bx), y2), sixteenth, _CMP_LE_OQ);
+                __m256d inside = _mm256_or_pd(cardioid, bulb);
+                it = _mm256_and_pd(inside, iterationReached);
+                active = _mm256_andnot_pd(inside, active);
+            }
+            __m256d savedX = zx;
+            __m256d savedY = zy;
+
+            for (unsigned int k = 0; k < span.iteration; k++)
+            {
+                __m256d magnitude = _mm256_add_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+                active = _mm256_and_pd(active, _mm256_cmp_pd(magnitude, four, _CMP_LT_OQ));
+                if (_mm256_movemask_pd(active) == 0)
+                    break;
+
+                it = _mm256_add_pd(it, _mm256_and_pd(active, one));
+
+                zx = _mm256_add_pd(zx, cx);
+                zy = _mm256_add_pd(zy, cy);
+                __m256d zx2 = _mm256_sub_pd(_mm256_mul_pd(zx, zx), _mm256_mul_pd(zy, zy));
+                zy = _mm256_mul_pd(_mm256_mul_pd(two, zx), zy);
+                zx = zx2;
+
+                // Back to the point saved at the last power of two steps: on a cycle, inside too
+                if (span.interiorChecks)
+                {
+                    __m256d dx = _mm256_andnot_pd(signBit, _mm256_sub_pd(zx, savedX));
+                    __m256d dy = _mm256_andnot_pd(signBit, _mm256_sub_pd(zy, savedY));
+                    __m256d periodic = _mm256_and_pd(active, _mm256_and_pd(_mm256_cmp_pd(dx, epsilon, _CMP_LT_OQ), _mm256_cmp_pd(dy, epsilon, _CMP_LT_OQ)));
+                    if (_mm256_movemask_pd(periodic) != 0)
+                    {
+                        it = _mm256_blendv_pd(it, iterationReached, periodic);
+                        active = _mm256_andnot_pd(periodic, active);
+                    }
+                    if ((k & (k + 1)) == 0)
+                    {
+                        savedX = zx;
+                        savedY = zy;
+                    }
+                }
+            }
+
+            __m128i result = _mm256_cvttpd_epi32(it);
+            result = _mm_andnot_si128(_mm_cmpeq_epi32(result, iteration), result);
+
+            if (span.count - i >= 4)
+            {
+                _mm_storeu_si128((__m128i*)(out + i), result);
+            }
+            else
+            {
+                alignas(16) uint32_t tail[4];
+                _mm_store_si128((__m128i*)tail, result);
+                for (int j = 0; j < span.count - i; j++)
+                    out[i + j] = tail[j];
+            }
+        }
+    }
+};
+
+#endif // FRACTAL_KERNEL_X86
@@ -0,0 +1,202 @@
+#include "fractal_kernel.h"
+
+// Only called after GetRowKernel() checked the CPU. Nothing from the standard library is
+// included here, so no inline function compiled for AVX-512 can leak into other translation units.
+// Lanes that escaped are frozen by the write masks instead of being blended.
+
+#if FRACTAL_KERNEL_X86
+
+#include <immintrin.h>
+
+#if defined(__GNUC__)
+#define FRACTAL_TARGET __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#else
+#define FRACTAL_TARGET
+#endif
+
+namespace fractal
+{
+    // 16 pixels per step
+
+    FRACTAL_TARGET void RowKernelAvx512Float(const RowSpan& span, uint32_t* out)
+    {
+        const __m512 rangeX = _mm512_set1_ps((float)span.rangeX);
+        const __m512 rangeW = _mm512_set1_ps((float)span.rangeW);
+        const __m512 dimX = _mm512_set1_ps((float)span.dimX);
+        const __m512 cy = _mm512_set1_ps((float)span.rangeY + (float)span.rangeH * (float)span.y / (float)span.dimY);
+
+        const __m512 lane = _mm512_setr_ps(
+            0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+            8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f
+        );
+        const __m512 one = _mm512_set1_ps(1.0f);
+        const __m512 two = _mm512_set1_ps(2.0f);
+        const __m512 four = _mm512_set1_ps(4.0f);
+        const __m512 quarter = _mm512_set1_ps(0.25f);
+        const __m512 sixteenth = _mm512_set1_ps(0.0625f);
+        const __m512 epsilon = _mm512_set1_ps(PERIOD_EPSILON_FLOAT);
+        const __m512 iterationReached = _mm512_set1_ps((float)span.iteration);
+        const __m512i iteration = _mm512_set1_epi32((int)span.iteration);
+
+        for (int i = 0; i < span.count; i += 16)
+        {
+            __m512 x = _mm512_add_ps(_mm512_set1_ps((float)(span.x + i)), lane);
+            __m512 cx = _mm512_add_ps(rangeX, _mm512_div_ps(_mm512_mul_ps(rangeW, x), dimX));
+
+            __m512 zx = _mm512_setzero_ps();
+            __m512 zy = _mm512_setzero_ps();
+            __m512 it = _mm512_setzero_ps();
+            __mmask16 active = 0xFFFF;
+
+            // Main cardioid and period 2 bulb: inside, as if they had run all the iterations
+            if (span.interiorChecks)
+            {
+                __m512 qx = _mm512_sub_ps(cx, quarter);
+                __m512 y2 = _mm512_mul_ps(cy, cy);
+                __m512 q = _mm512_add_ps(_mm512_mul_ps(qx, qx), y2);
+                __mmask16 cardioid = _mm512_cmp_ps_mask(_mm512_mul_ps(q, _mm512_add_ps(q, qx)), _mm512_mul_ps(quarter, y2), _CMP_LE_OQ);
+                __m512 bx = _mm512_add_ps(cx, one);
+                __mmask16 bulb = _mm512_cmp_ps_mask(_mm512_add_ps(_mm512_mul_ps(bx, bx), y2), sixteenth, _CMP_LE_OQ);
+                __mmask16 inside = cardioid | bulb;
+                it = _mm512_mask_mov_ps(it, inside, iterationReached);
+                active = (__mmask16)(active & ~inside);
+            }
+            __m512 savedX = zx;
+            __m512 savedY = zy;
+
+            for (unsigned int k = 0; k < span.iteration; k++)
+            {
+                __m512 magnitude = _mm512_add_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+                active = _mm512_mask_cmp_ps_mask(active, magnitude, four, _CMP_LT_OQ);
+                if (active == 0)
+                    break;
+
+                it = _mm512_mask_add_ps(it, active, it, one);
+
+                zx = _mm512_add_ps(zx, cx);
+                zy = _mm512_add_ps(zy, cy);
+                __m512 zx2 = _mm512_sub_ps(_mm512_mul_ps(zx, zx), _mm512_mul_ps(zy, zy));
+                zy = _mm512_mul_ps(_mm512_mul_ps(two, zx), zy);
+                zx = zx2;
+
+                // Back to the point saved at the last power of two steps: on a cycle, inside too
+                if (span.interiorChecks)
+                {
+                    __m512 dx = _mm512_abs_ps(_mm512_sub_ps(zx, savedX));
+                    __m512 dy = _mm512_abs_ps(_mm512_sub_ps(zy, savedY));
+                    __mmask16 periodic = _mm512_mask_cmp_ps_mask(active, dx, epsilon, _CMP_LT_OQ);
+                    periodic = _mm512_mask_cmp_ps_mask(periodic, dy, epsilon, _CMP_LT_OQ);
+                    if (periodic != 0)
+                    {
+                        it = _mm512_mask_mov_ps(it, periodic, iterationReached);
+                        active = (__mmask16)(active & ~periodic);
+                    }
+                    if ((k & (k + 1)) == 0)
+                    {
+                        savedX = zx;
+                        savedY = zy;
+                    }
+                }
+            }
+
+            __m512i result = _mm512_cvttps_epi32(it);
+            result = _mm512_mask_mov_epi32(result, _mm512_cmpeq_epi32_mask(result, iteration), _mm512_setzero_si512());
+
+            const int remaining = span.count - i;
+            const __mmask16 store = (remaining >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << remaining) - 1);
+            _mm512_mask_storeu_epi32(out + i, store, result);
+        }
+    }
+
+    // 8 pixels per step
+
+    FRACTAL_TARGET void RowKernelAvx512Double(const RowSpan& span, uint32_t* out)
+    {
+        const __m512d rangeX = _mm512_set1_pd(span.rangeX);
+        const __m512d rangeW = _mm512_set1_pd(span.rangeW);
+        const __m512d dimX = _mm512_set1_pd(span.dimX);
+        const __m512d cy = _mm512_set1_pd(span.rangeY + span.rangeH * (double)span.y / span.dimY);
+
+        const __m512d lane = _mm512_setr_pd(0.0, 1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0);
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d two = _mm512_set1_pd(2.0);
+        const __m512d four = _mm512_set1_pd(4.0);
+        const __m512d quarter = _mm512_set1_pd(0.25);
+        const __m512d sixteenth = _mm512_set1_pd(0.0625);
+        const __m512d epsilon = _mm512_set1_pd(PERIOD_EPSILON_DOUBLE);
+        const __m512d iterationReached = _mm512_set1_pd((double)span.iteration);
+        const __m512i iteration = _mm512_set1_epi32((int)span.iteration);
+
+        for (int i = 0; i < span.count; i += 8)
+        {
+            __m512d x = _mm512_add_pd(_mm512_set1_pd((double)(span.x + i)), lane);
+            __m512d cx = _mm512_add_pd(rangeX, _mm512_div_pd(_mm512_mul_pd(rangeW, x), dimX));
+
+            __m512d zx = _mm512_setzero_pd();
+            __m512d zy = _mm512_setzero_pd();
+            __m512d it = _mm512_setzero_pd();
+            __mmask8 active = 0xFF;
+
+            // Main cardioid and period 2 bulb: inside, as if they had run all the iterations
+            if (span.interiorChecks)
+            {
+                __m512d qx = _mm512_sub_pd(cx, quarter);
+                __m512d y2 = _mm512_mul_pd(cy, cy);
+                __m512d q = _mm512_add_pd(_mm512_mul_pd(qx, qx), y2);
+                __mmask8 cardioid = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, qx)), _mm512_mul_pd(quarter, y2), _CMP_LE_OQ);
+                __m512d bx = _mm512_add_pd(cx, one);
+                __mmask8 bulb = _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(bx, bx), y2), sixteenth, _CMP_LE_OQ);
+                __mmask8 inside = cardioid | bulb;
+                it = _mm512_mask_mov_pd(it, inside, iterationReached);
+                active = (__mmask8)(active & ~inside);
+            }
+            __m512d savedX = zx;
+            __m512d savedY = zy;
+
+            for (unsigned int k = 0; k < span.iteration; k++)
+            {
+                __m512d magnitude = _mm512_add_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+                active = _mm512_mask_cmp_pd_mask(active, magnitude, four, _CMP_LT_OQ);
+                if (active == 0)
+                    break;
+
+                it = _mm512_mask_add_pd(it, active, it, one);
+
+                zx = _mm512_add_pd(zx, cx);
+                zy = _mm512_add_pd(zy, cy);
+                __m512d zx2 = _mm512_sub_pd(_mm512_mul_pd(zx, zx), _mm512_mul_pd(zy, zy));
+                zy = _mm512_mul_pd(_mm512_mul_pd(two, zx), zy);
+                zx = zx2;
+
+                // Back to the point saved at the last power of two steps: on a cycle, inside too
+                if (span.interiorChecks)
+                {
+                    __m512d dx = _mm512_abs_pd(_mm512_sub_pd(zx, savedX));
+                    __m512d dy = _mm512_abs_pd(_mm512_sub_pd(zy, savedY));
+                    __mmask8 periodic = _mm512_mask_cmp_pd_mask(active, dx, epsilon, _CMP_LT_OQ);
+                    periodic = _mm512_mask_cmp_pd_mask(periodic, dy, epsilon, _CMP_LT_OQ);
+                    if (periodic != 0)
+                    {
+                        it = _mm512_mask_mov_pd(it, periodic, iterationReached);
+                        active = (__mmask8)(active & ~periodic);
+                    }
+                    if ((k & (k + 1)) == 0)
+                    {
+                        savedX = zx;
+                        savedY = zy;
+                    }
+                }
+            }
+
+            // 8 results fit the low half of a 512 bit integer register
+            __m512i result = _mm512_castsi256_si512(_mm512_cvttpd_epi32(it));
+            result = _mm512_mask_mov_epi32(result, _mm512_cmpeq_epi32_mask(result, iteration), _mm512_setzero_si512());
+
+            const int remaining = span.count - i;
+            const __mmask16 store = (remaining >= 8) ? (__mmask16)0x00FF : (__mmask16)((1u << remaining) - 1);
+            _mm512_mask_storeu_epi32(out + i, store, result);
+        }
+    }
+};
+
+#endif // FRACTAL_KERNEL_X86
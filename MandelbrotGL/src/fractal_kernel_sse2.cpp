@@ -0,0 +1,206 @@
+#include "fractal_kernel.h"
+
+// Nothing from the standard library is included below the target switch, so no inline function
+// compiled for a wider instruction set can leak into other translation units.
+
+#if FRACTAL_KERNEL_X86
+
+#include <emmintrin.h>
+
+#if defined(__GNUC__)
+#define FRACTAL_TARGET __attribute__((target("sse2")))
+#else
+#define FRACTAL_TARGET
+#endif
+
+namespace fractal
+{
+    // 4 pixels per step
+
+    FRACTAL_TARGET void RowKernelSse2Float(const RowSpan& span, uint32_t* out)
+    {
+        const __m128 rangeX = _mm_set1_ps((float)span.rangeX);
+        const __m128 rangeW = _mm_set1_ps((float)span.rangeW);
+        const __m128 dimX = _mm_set1_ps((float)span.dimX);
+        const __m128 cy = _mm_set1_ps((float)span.rangeY + (float)span.rangeH * (float)span.y / (float)span.dimY);
+
+        const __m128 lane = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 four = _mm_set1_ps(4.0f);
+        const __m128 quarter = _mm_set1_ps(0.25f);
+        const __m128 sixteenth = _mm_set1_ps(0.0625f);
+        const __m128 epsilon = _mm_set1_ps(PERIOD_EPSILON_FLOAT);
+        const __m128 signBit = _mm_set1_ps(-0.0f);
+        const __m128 iterationReached = _mm_set1_ps((float)span.iteration);
+        const __m128i iteration = _mm_set1_epi32((int)span.iteration);
+
+        for (int i = 0; i < span.count; i += 4)
+        {
+            __m128 x = _mm_add_ps(_mm_set1_ps((float)(span.x + i)), lane);
+            __m128 cx = _mm_add_ps(rangeX, _mm_div_ps(_mm_mul_ps(rangeW, x), dimX));
+
+            __m128 zx = _mm_setzero_ps();
+            __m128 zy = _mm_setzero_ps();
+            __m128 it = _mm_setzero_ps();
+            __m128 active = _mm_cmpeq_ps(zx, zx);
+
+            // Main cardioid and period 2 bulb: inside, as if they had run all the iterations
+            if (span.interiorChecks)
+            {
+                __m128 qx = _mm_sub_ps(cx, quarter);
+                __m128 y2 = _mm_mul_ps(cy, cy);
+                __m128 q = _mm_add_ps(_mm_mul_ps(qx, qx), y2);
+                __m128 cardioid = _mm_cmple_ps(_mm_mul_ps(q, _mm_add_ps(q, qx)), _mm_mul_ps(quarter, y2));
+                __m128 bx = _mm_add_ps(cx, one);
+                __m128 bulb = _mm_cmple_ps(_mm_add_ps(_mm_mul_ps(bx, bx), y2), sixteenth);
+                __m128 inside = _mm_or_ps(cardioid, bulb);
+                it = _mm_and_ps(inside, iterationReached);
+                active = _mm_andnot_ps(inside, active);
+            }
+            __m128 savedX = zx;
+            __m128 savedY = zy;
+
+            for (unsigned int k = 0; k < span.iteration; k++)
+            {
+                __m128 magnitude = _mm_add_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy));
+                active = _mm_and_ps(active, _mm_cmplt_ps(magnitude, four));
+                if (_mm_movemask_ps(active) == 0)
+                    break;
+
+                it = _mm_add_ps(it, _mm_and_ps(active, one));
+
+                zx = _mm_add_ps(zx, cx);
+                zy = _mm_add_ps(zy, cy);
+                __m128 zx2 = _mm_sub_ps(_mm_mul_ps(zx, zx), _mm_mul_ps(zy, zy));
+                zy = _mm_mul_ps(_mm_mul_ps(two, zx), zy);
+                zx = zx2;
+
+                // Back to the point saved at the last power of two steps: on a cycle, inside too
+                if (span.interiorChecks)
+                {
+                    __m128 dx = _mm_andnot_ps(signBit, _mm_sub_ps(zx, savedX));
+                    __m128 dy = _mm_andnot_ps(signBit, _mm_sub_ps(zy, savedY));
+                    __m128 periodic = _mm_and_ps(active, _mm_and_ps(_mm_cmplt_ps(dx, epsilon), _mm_cmplt_ps(dy, epsilon)));
+                    if (_mm_movemask_ps(periodic) != 0)
+                    {
+                        it = _mm_or_ps(_mm_andnot_ps(periodic, it), _mm_and_ps(periodic, iterationReached));
+                        active = _mm_andnot_ps(periodic, active);
+                    }
+                    if ((k & (k + 1)) == 0)
+                    {
+                        savedX = zx;
+                        savedY = zy;
+                    }
+                }
+            }
+
+            __m128i result = _mm_cvttps_epi32(it);
+            result = _mm_andnot_si128(_mm_cmpeq_epi32(result, iteration), result);
+
+            if (span.count - i >= 4)
+            {
+                _mm_storeu_si128((__m128i*)(out + i), result);
+            }
+            else
+            {
+                alignas(16) uint32_t tail[4];
+                _mm_store_si128((__m128i*)tail, result);
+                for (int j = 0; j < span.count - i; j++)
+                    out[i + j] = tail[j];
+            }
+        }
+    }
+
+    // 2 pixels per step
+
+    FRACTAL_TARGET void RowKernelSse2Double(const RowSpan& span, uint32_t* out)
+    {
+        const __m128d rangeX = _mm_set1_pd(span.rangeX);
+        const __m128d rangeW = _mm_set1_pd(span.rangeW);
+        const __m128d dimX = _mm_set1_pd(span.dimX);
+        const __m128d cy = _mm_set1_pd(span.rangeY + span.rangeH * (double)span.y / span.dimY);
+
+        const __m128d lane = _mm_setr_pd(0.0, 1.0);
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d two = _mm_set1_pd(2.0);
+        const __m128d four = _mm_set1_pd(4.0);
+        const __m128d quarter = _mm_set1_pd(0.25);
+        const __m128d sixteenth = _mm_set1_pd(0.0625);
+        const __m128d epsilon = _mm_set1_pd(PERIOD_EPSILON_DOUBLE);
+        const __m128d signBit = _mm_set1_pd(-0.0);
+        const __m128d iterationReached = _mm_set1_pd((double)span.iteration);
+        const __m128i iteration = _mm_set1_epi32((int)span.iteration);
+
+        for (int i = 0; i < span.count; i += 2)
+        {
+            __m128d x = _mm_add_pd(_mm_set1_pd((double)(span.x + i)), lane);
+            __m128d cx = _mm_add_pd(rangeX, _mm_div_pd(_mm_mul_pd(rangeW, x), dimX));
+
+            __m128d zx = _mm_setzero_pd();
+            __m128d zy = _mm_setzero_pd();
+            __m128d it = _mm_setzero_pd();
+            __m128d active = _mm_cmpeq_pd(zx, zx);
+
+            // Main cardioid and period 2 bulb: inside, as if they had run all the iterations
+            if (span.interiorChecks)
+            {
+                __m128d qx = _mm_sub_pd(cx, quarter);
+                __m128d y2 = _mm_mul_pd(cy, cy);
+                __m128d q = _mm_add_pd(_mm_mul_pd(qx, qx), y2);
+                __m128d cardioid = _mm_cmple_pd(_mm_mul_pd(q, _mm_add_pd(q, qx)), _mm_mul_pd(quarter, y2));
+                __m128d bx = _mm_add_pd(cx, one);
+                __m128d bulb = _mm_cmple_pd(_mm_add_pd(_mm_mul_pd(bx, bx), y2), sixteenth);
+                __m128d inside = _mm_or_pd(cardioid, bulb);
+                it = _mm_and_pd(inside, iterationReached);
+                active = _mm_andnot_pd(inside, active);
+            }
+            __m128d savedX = zx;
+            __m128d savedY = zy;
+
+            for (unsigned int k = 0; k < span.iteration; k++)
+            {
+                __m128d magnitude = _mm_add_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy));
+                active = _mm_and_pd(active, _mm_cmplt_pd(magnitude, four));
+                if (_mm_movemask_pd(active) == 0)
+                    break;
+
+                it = _mm_add_pd(it, _mm_and_pd(active, one));
+
+                zx = _mm_add_pd(zx, cx);
+                zy = _mm_add_pd(zy, cy);
+                __m128d zx2 = _mm_sub_pd(_mm_mul_pd(zx, zx), _mm_mul_pd(zy, zy));
+                zy = _mm_mul_pd(_mm_mul_pd(two, zx), zy);
+                zx = zx2;
+
+                // Back to the point saved at the last power of two steps: on a cycle, inside too
+                if (span.interiorChecks)
+                {
+                    __m128d dx = _mm_andnot_pd(signBit, _mm_sub_pd(zx, savedX));
+                    __m128d dy = _mm_andnot_pd(signBit, _mm_sub_pd(zy, savedY));
+                    __m128d periodic = _mm_and_pd(active, _mm_and_pd(_mm_cmplt_pd(dx, epsilon), _mm_cmplt_pd(dy, epsilon)));
+                    if (_mm_movemask_pd(periodic) != 0)
+                    {
+                        it = _mm_or_pd(_mm_andnot_pd(periodic, it), _mm_and_pd(periodic, iterationReached));
+                        active = _mm_andnot_pd(periodic, active);
+                    }
+                    if ((k & (k + 1)) == 0)
+                    {
+                        savedX = zx;
+                        savedY = zy;
+                    }
+                }
+            }
+
+            __m128i result = _mm_cvttpd_epi32(it);
+            result = _mm_andnot_si128(_mm_cmpeq_epi32(result, iteration), result);
+
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128((__m128i*)lanes, result);
+            for (int j = 0; j < 2 && i + j < span.count; j++)
+                out[i + j] = lanes[j];
+        }
+    }
+};
+
+#endif // FRACTAL_KERNEL_X86
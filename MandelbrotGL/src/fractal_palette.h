@@ -0,0 +1,76 @@
+#ifndef FRACTAL_PALETTE_H
+#define FRACTAL_PALETTE_H
+
+#include "glm.hpp"
+
+#include <stdint.h>
+
+namespace fractal
+{
+    // The color ramp res/basic_texture_fs.glsl samples, uploaded as a 1D RGB8 texture.
+    // PaletteColor() does the same lookup on the CPU, for images written without OpenGL.
+
+    constexpr uint8_t PALETTE[] = {
+          0,   0,   0,
+        230, 200,   0,
+        240, 160,   0,
+        250, 100,   0,
+        255,  50,  10,
+        230,   0,  50,
+        150,   0, 130,
+        100,   0, 190,
+         20,   0, 220,
+          0,  50, 230,
+          0, 100, 200,
+          0, 150, 140,
+          0, 160, 120,
+          0, 170, 100,
+          0, 180,  80,
+         10, 190,  50,
+         20, 200,  15,
+         30, 210,   0,
+        255, 220,   0,
+        255, 220,   0,
+        255, 220,   0,
+        255, 220,   0,
+        255, 220,   0,
+        255, 220,   0,
+        255, 220,   0,
+        255, 220,   0
+    };
+    constexpr int PALETTE_SIZE = (int)(sizeof(PALETTE) / sizeof(uint8_t)) / 3;
+
+    // Iterations the whole ramp spans, the "2048.0" of the fragment shader. Escapes past it go round
+    // the ramp again, from its dark end, rather than into the black border with the inside.
+    constexpr float PALETTE_SPAN = 2048.0f;
+
+    // What the fragment shader gives an escape iteration, 0 standing for inside
+    inline float PaletteShade(uint32_t it, int iteration) noexcept
+    {
+        return (it >= (uint32_t)iteration) ? 0.0f : (float)it;
+    }
+
+    // GL_LINEAR between texel centers, GL_CLAMP_TO_BORDER with the default black border, of the
+    // shade modulo PALETTE_SPAN as the fragment shader takes it
+    inline glm::u8vec3 PaletteColor(float shade) noexcept
+    {
+        const float lap = glm::mod(shade, PALETTE_SPAN);
+        const float t = glm::clamp(lap / PALETTE_SPAN * PALETTE_SIZE - 0.5f, -1.0f, (float)PALETTE_SIZE);
+        const float base = glm::floor(t);
+        const float weight = t - base;
+
+        auto texel = [](int i) -> glm::vec3
+        {
+            if (i < 0 || i >= PALETTE_SIZE)
+            {
+                return glm::vec3(0.0f);
+            }
+            return glm::vec3(PALETTE[i * 3], PALETTE[i * 3 + 1], PALETTE[i * 3 + 2]);
+        };
+
+        const glm::vec3 color = glm::mix(texel((int)base), texel((int)base + 1), weight);
+        return glm::u8vec3(glm::round(color));
+    }
+};
+
+#endif // FRACTAL_PALETTE_H
@@ -0,0 +1,157 @@
+#include "fractal_perturbation_engine.h"
+
+#include <float.h>
+
+namespace fractal
+{
+    PerturbationEngine::PerturbationEngine(unsigned int threadCount, bool pinThreads):
+        scheduler(threadCount, pinThreads),
+        threadCandidates(scheduler.ThreadCount()),
+        threadGlitchCounts(scheduler.ThreadCount()),
+        threadMinSkips(scheduler.ThreadCount())
+    {
+    }
+
+    void PerturbationEngine::Compute(const Frame& frame)
+    {
+        const glm::dvec2 dim = frame.imageDim;
+        const glm::dvec2 range = { frame.rangeRect.z, frame.rangeRect.w };
+
+        // Same mapping as uRangeRect, relative to the frame center
+        auto pixelDelta = [&dim, &range](int x, int y)
+        {
+            return -range / 2.0 + range * glm::dvec2(x, y) / dim;
+        };
+
+        compute(frame, pixelDelta, Fixed::LimbsFor(glm::min(range.x / dim.x, range.y / dim.y)));
+    }
+
+    void PerturbationEngine::Compute(const Frame& frame, const PixelMap& map)
+    {
+        compute(frame, map, glm::max(frame.centerX.LimbCount(), frame.centerY.LimbCount()));
+    }
+
+    template<typename Map>
+    void PerturbationEngine::compute(const Frame& frame, const Map& pixelDelta, int limbs)
+    {
+        pixelsDim = frame.imageDim;
+        pixels.resize((size_t)frame.imageDim.x * frame.imageDim.y);
+        glitched.assign(pixels.size(), 1);  // First reference computes everything
+
+        const unsigned int iteration = (unsigned int)frame.iteration;
+
+        glm::dvec2 referenceDelta = { 0.0, 0.0 };
+        unsigned int pending = (unsigned int)pixels.size();
+        stats = { 0, 0, 0, 0 };
+
+        for (unsigned int reference = 0; reference < maxReferences; reference++)
+        {
+            const bool lastReference = (reference + 1 == maxReferences);
+            if (lastReference)
+            {
+                stats.glitchedPixels = pending;
+            }
+
+            orbit.Compute(
+                frame.centerX + Fixed(referenceDelta.x, limbs),
+                frame.centerY + Fixed(referenceDelta.y, limbs),
+                iteration
+            );
+            stats.referenceCount++;
+
+            // The farthest pixel from the reference is at a corner
+            double radius = 0.0;
+            for (int corner = 0; corner < 4; corner++)
+            {
+                const glm::dvec2 dc = pixelDelta((corner & 1) ? pixelsDim.x - 1 : 0, (corner & 2) ? pixelsDim.y - 1 : 0) - referenceDelta;
+                radius = glm::max(radius, glm::length(dc));
+            }
+            series.Compute(orbit, seriesApproximation ? radius : 0.0, seriesApproximation ? iteration : 1);
+            if (reference == 0)
+            {
+                stats.seriesSkip = series.MaxSkip();
+            }
+
+            for (size_t i = 0; i < threadCandidates.size(); i++)
+            {
+                threadCandidates[i] = { DBL_MAX, 0, 0 };
+                threadGlitchCounts[i] = 0;
+                threadMinSkips[i] = series.MaxSkip();
+            }
+
+            scheduler.Run(frame.imageDim, [&](const Tile& tile, unsigned int threadIndex)
+            {
+                GlitchCandidate& candidate = threadCandidates[threadIndex];
+                unsigned int glitchCount = 0;
+                unsigned int skip = GLITCH;     // Probed when the tile has pixels left to do
+
+                for (int y = tile.y; y < tile.y + tile.h; y++)
+                {
+                    const size_t row = (size_t)y * pixelsDim.x;
+                    for (int x = tile.x; x < tile.x + tile.w; x++)
+                    {
+                        if (glitched[row + x] == 0)
+                        {
+                            continue;
+                        }
+
+                        if (skip == GLITCH)
+                        {
+                            const glm::dvec2 probes[4] = {
+                                pixelDelta(tile.x, tile.y) - referenceDelta,
+                                pixelDelta(tile.x + tile.w - 1, tile.y) - referenceDelta,
+                                pixelDelta(tile.x, tile.y + tile.h - 1) - referenceDelta,
+                                pixelDelta(tile.x + tile.w - 1, tile.y + tile.h - 1) - referenceDelta
+                            };
+                            skip = series.ValidSkip(orbit, probes, 4, series.MaxSkip());
+                            threadMinSkips[threadIndex] = glm::min(threadMinSkips[threadIndex], skip);
+                        }
+
+                        const glm::dvec2 dc = pixelDelta(x, y) - referenceDelta;
+                        double depth = 0.0;
+                        unsigned int it = PerturbedEscapeTime(orbit, dc, iteration, lastReference == false, depth,
+                            skip, series.Evaluate(skip, dc));
+
+                        if (it == GLITCH)
+                        {
+                            glitchCount++;
+                            if (depth < candidate.depth)
+                            {
+                                candidate = { depth, x, y };
+                            }
+                            continue;
+                        }
+
+                        glitched[row + x] = 0;
+                        pixels[row + x] = it;
+                    }
+                }
+
+                threadGlitchCounts[threadIndex] += glitchCount;
+            });
+
+            unsigned int glitchCount = 0;
+            GlitchCandidate best = { DBL_MAX, 0, 0 };
+            for (size_t i = 0; i < threadCandidates.size(); i++)
+            {
+                if (reference == 0)
+                {
+                    stats.minTileSkip = (i == 0) ? threadMinSkips[i] : glm::min(stats.minTileSkip, threadMinSkips[i]);
+                }
+                glitchCount += threadGlitchCounts[i];
+                if (threadCandidates[i].depth < best.depth)
+                {
+                    best = threadCandidates[i];
+                }
+            }
+
+            pending = glitchCount;
+            if (pending == 0)
+            {
+                break;
+            }
+
+            referenceDelta = pixelDelta(best.x, best.y);
+        }
+    }
+};
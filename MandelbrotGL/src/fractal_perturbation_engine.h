@@ -0,0 +1,86 @@
+#ifndef FRACTAL_PERTURBATION_ENGINE_H
+#define FRACTAL_PERTURBATION_ENGINE_H
+
+#include "fractal_engine.h"
+#include "fractal_reference_orbit.h"
+#include "fractal_scheduler.h"
+#include "fractal_series.h"
+
+#include <functional>
+#include <vector>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Deep zoom on the CPU: one reference orbit at the frame center in Fixed, every pixel iterating
+    // only its double delta from it. Pixels that glitch are redone against a new reference picked
+    // among them, up to maxReferences times. Needs a Frame from MakeFrame().
+    //
+    // With series approximation on, each tile checks how far the series holds at its corners and
+    // its pixels start iterating there.
+    //
+    // Pixels can also sit anywhere around the center through a PixelMap, like the log-polar
+    // samples of ExponentialMap, as long as the farthest ones from it are at the corners.
+
+    class PerturbationEngine : public FractalEngine
+    {
+    public:
+
+        struct Stats
+        {
+            unsigned int referenceCount;
+            unsigned int glitchedPixels;    // Left after the last reference, computed without glitch detection
+            unsigned int seriesSkip;        // Bound from the first reference's coefficients
+            unsigned int minTileSkip;       // What the probes of the worst tile allowed
+        };
+
+        // Offset of pixel (x, y) from the frame center in the complex plane
+        typedef std::function<glm::dvec2(int x, int y)> PixelMap;
+
+        PerturbationEngine(unsigned int threadCount = TileScheduler::DefaultThreadCount(), bool pinThreads = false);
+
+        const char* Name() const noexcept override { return "Perturbation"; }
+        void Compute(const Frame& frame) override;
+
+        // Same, pixels placed by map instead of rangeRect, which is then unused. New references
+        // get as many limbs as the frame center has.
+        void Compute(const Frame& frame, const PixelMap& map);
+
+        void SetMaxReferences(unsigned int count) noexcept { maxReferences = (count == 0) ? 1 : count; }
+        void SetSeriesApproximation(bool enable) noexcept { seriesApproximation = enable; }
+        bool GetSeriesApproximation() const noexcept { return seriesApproximation; }
+
+        Stats LastStats() const noexcept { return stats; }
+
+        // Same layout and values as CpuEngine::Pixels()
+        const std::vector<uint32_t>& Pixels() const noexcept { return pixels; }
+        glm::ivec2 PixelsDim() const noexcept { return pixelsDim; }
+
+    private:
+
+        template<typename Map>
+        void compute(const Frame& frame, const Map& pixelDelta, int limbs);
+
+        struct GlitchCandidate
+        {
+            double depth;   // |Z + dz|^2 / |Z|^2, the smaller the closer to what made the reference fail
+            int x, y;
+        };
+
+        TileScheduler scheduler;
+        ReferenceOrbit orbit;
+        SeriesApproximation series;
+        unsigned int maxReferences = 8;
+        bool seriesApproximation = true;
+        Stats stats = { 0, 0, 0, 0 };
+
+        std::vector<uint32_t> pixels;
+        std::vector<uint8_t> glitched;
+        std::vector<GlitchCandidate> threadCandidates;
+        std::vector<unsigned int> threadGlitchCounts;
+        std::vector<unsigned int> threadMinSkips;
+        glm::ivec2 pixelsDim = { 0, 0 };
+    };
+};
+
+#endif // FRACTAL_PERTURBATION_ENGINE_H
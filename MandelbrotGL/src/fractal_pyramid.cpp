@@ -0,0 +1,289 @@
+#include "fractal_pyramid.h"
+#include "fractal_image.h"
+#include "fractal_palette.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace fractal
+{
+    static bool makeDirectory(const std::string& path)
+    {
+#ifdef _WIN32
+        return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+        return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+    }
+
+    DeepZoomPyramid::DeepZoomPyramid(const char* path, int tileSize, unsigned int threadCount, unsigned int maxInFlight):
+        path(path),
+        tileSize(tileSize),
+        maxInFlight((maxInFlight == 0) ? 2 * glm::max(threadCount, 1u) : maxInFlight)
+    {
+        const size_t extension = this->path.rfind(".dzi");
+        if (extension != std::string::npos && extension + 4 == this->path.size())
+        {
+            this->path.erase(extension);
+        }
+
+        for (unsigned int i = 0; i < glm::max(threadCount, 1u); i++)
+        {
+            workers.emplace_back(&DeepZoomPyramid::workerLoop, this);
+        }
+    }
+
+    DeepZoomPyramid::~DeepZoomPyramid()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        queued.notify_all();
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    bool DeepZoomPyramid::Build(const Frame& frame, const RenderTile& render)
+    {
+        this->frame = frame;
+        failed = false;
+        renderedTiles = 0;
+        downsampledTiles = 0;
+
+        // Halved, rounding up, down to a single pixel; level 0 comes first
+        levelDims.assign(1, frame.imageDim);
+        while (levelDims.back().x > 1 || levelDims.back().y > 1)
+        {
+            levelDims.push_back((levelDims.back() + 1) / 2);
+        }
+        std::reverse(levelDims.begin(), levelDims.end());
+
+        if (makeDirectory(path + "_files") == false)
+        {
+            printf("Error: can't create %s_files\n", path.c_str());
+            return false;
+        }
+        for (size_t level = 0; level < levelDims.size(); level++)
+        {
+            if (makeDirectory(path + "_files/" + std::to_string(level)) == false)
+            {
+                printf("Error: can't create the directory of level %zu\n", level);
+                return false;
+            }
+        }
+
+        build(0, { 0, 0 }, render).wait();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this]() { return inFlight == 0; });
+        }
+
+        return writeDescriptor() && failed == false;
+    }
+
+    // Future of the tile, after its children were rendered or scheduled
+
+    DeepZoomPyramid::TileFuture DeepZoomPyramid::build(int level, glm::ivec2 tile, const RenderTile& render)
+    {
+        const Recti rect = tileRect(level, tile);
+
+        if (level + 1 == (int)levelDims.size())
+        {
+            // Engines count rows from the bottom
+            std::vector<uint32_t> pixels;
+            const Frame tileFrame = SubFrame(frame, { rect.x, frame.imageDim.y - rect.Top() }, { rect.w, rect.h });
+            if (failed || render(tileFrame, pixels) == false)
+            {
+                failed = true;
+                return submit([]() { return TileImagePtr(); });
+            }
+            renderedTiles++;
+
+            return submit([this, level, rect, pixels = std::move(pixels)]()
+            {
+                TileImagePtr image = colorTile(rect, pixels);
+                writeTile(level, *image);
+                return image;
+            });
+        }
+
+        // Children that exist, the edges of the level may have fewer than four
+        std::vector<TileFuture> children(4);
+        for (int i = 0; i < 4; i++)
+        {
+            const glm::ivec2 child = tile * 2 + glm::ivec2(i & 1, i >> 1);
+            if (tileRect(level + 1, child).Empty() == false)
+            {
+                children[i] = build(level + 1, child, render);
+            }
+        }
+
+        return submit([this, level, rect, children]()
+        {
+            TileImagePtr image = downsample(rect, children.data());
+            writeTile(level, *image);
+            downsampledTiles++;
+            return image;
+        });
+    }
+
+    DeepZoomPyramid::TileImagePtr DeepZoomPyramid::colorTile(const Recti& rect, const std::vector<uint32_t>& pixels) const
+    {
+        std::shared_ptr<TileImage> image(new TileImage{ rect, std::vector<uint8_t>((size_t)rect.w * rect.h * 3) });
+
+        for (int y = 0; y < rect.h; y++)
+        {
+            const uint32_t* in = pixels.data() + (size_t)(rect.h - 1 - y) * rect.w;
+            uint8_t* out = image->rgb.data() + (size_t)y * rect.w * 3;
+            for (int x = 0; x < rect.w; x++, out += 3)
+            {
+                const glm::u8vec3 color = PaletteColor(PaletteShade(in[x], frame.iteration));
+                out[0] = color.r;
+                out[1] = color.g;
+                out[2] = color.b;
+            }
+        }
+        return image;
+    }
+
+    // Each pixel averages the 2x2 below it, fewer along odd edges of the level
+
+    DeepZoomPyramid::TileImagePtr DeepZoomPyramid::downsample(const Recti& rect, const TileFuture children[4]) const
+    {
+        std::shared_ptr<TileImage> image(new TileImage{ rect, std::vector<uint8_t>((size_t)rect.w * rect.h * 3, 0) });
+
+        const TileImage* below[4];
+        for (int i = 0; i < 4; i++)
+        {
+            below[i] = children[i].valid() ? children[i].get().get() : nullptr;
+        }
+
+        for (int y = 0; y < rect.h; y++)
+        {
+            for (int x = 0; x < rect.w; x++)
+            {
+                glm::uvec3 sum = { 0, 0, 0 };
+                unsigned int count = 0;
+                for (int sample = 0; sample < 4; sample++)
+                {
+                    // In the pixels of the level below, then of the child tile holding them
+                    const glm::ivec2 position = 2 * glm::ivec2(rect.x + x, rect.y + y) + glm::ivec2(sample & 1, sample >> 1);
+                    const glm::ivec2 child = position / tileSize - 2 * glm::ivec2(rect.x, rect.y) / tileSize;
+                    const TileImage* source = below[child.y * 2 + child.x];
+                    if (source == nullptr || position.x >= source->rect.Right() || position.y >= source->rect.Top())
+                    {
+                        continue;
+                    }
+
+                    const uint8_t* in = source->rgb.data() + ((size_t)(position.y - source->rect.y) * source->rect.w + (position.x - source->rect.x)) * 3;
+                    sum += glm::uvec3(in[0], in[1], in[2]);
+                    count++;
+                }
+
+                if (count > 0)
+                {
+                    uint8_t* out = image->rgb.data() + ((size_t)y * rect.w + x) * 3;
+                    const glm::uvec3 average = (sum + count / 2) / count;
+                    out[0] = (uint8_t)average.r;
+                    out[1] = (uint8_t)average.g;
+                    out[2] = (uint8_t)average.b;
+                }
+            }
+        }
+        return image;
+    }
+
+    void DeepZoomPyramid::writeTile(int level, const TileImage& image)
+    {
+        const std::string tilePath = path + "_files/" + std::to_string(level) + "/" +
+            std::to_string(image.rect.x / tileSize) + "_" + std::to_string(image.rect.y / tileSize) + ".png";
+
+        ImageWriter writer(tilePath.c_str(), ImageFormat::PNG, { image.rect.w, image.rect.h }, frame.iteration);
+        for (int y = 0; y < image.rect.h; y++)
+        {
+            writer.WriteColorRow(image.rgb.data() + (size_t)y * image.rect.w * 3);
+        }
+        if (writer.Close() == false)
+        {
+            failed = true;
+        }
+    }
+
+    bool DeepZoomPyramid::writeDescriptor() const
+    {
+        FILE* file = fopen((path + ".dzi").c_str(), "w");
+        if (file == nullptr)
+        {
+            printf("Error: can't open %s.dzi for writing\n", path.c_str());
+            return false;
+        }
+
+        fprintf(file,
+            "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+            "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" TileSize=\"%d\" Overlap=\"0\" Format=\"png\">\n"
+            "  <Size Width=\"%d\" Height=\"%d\"/>\n"
+            "</Image>\n",
+            tileSize, frame.imageDim.x, frame.imageDim.y
+        );
+        return fclose(file) == 0;
+    }
+
+    Recti DeepZoomPyramid::tileRect(int level, glm::ivec2 tile) const noexcept
+    {
+        const Recti grid = { tile.x * tileSize, tile.y * tileSize, tileSize, tileSize };
+        return grid.Intersect({ 0, 0, levelDims[level].x, levelDims[level].y });
+    }
+
+    // Jobs start in the order they come, so a parent only ever waits on children already running
+
+    DeepZoomPyramid::TileFuture DeepZoomPyramid::submit(std::function<TileImagePtr()> job)
+    {
+        auto task = std::make_shared<std::packaged_task<TileImagePtr()>>(std::move(job));
+        TileFuture future = task->get_future().share();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this]() { return inFlight < maxInFlight; });
+            inFlight++;
+            jobs.push_back([task]() { (*task)(); });
+        }
+        queued.notify_one();
+        return future;
+    }
+
+    void DeepZoomPyramid::workerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                queued.wait(lock, [this]() { return jobs.empty() == false || quit; });
+                if (jobs.empty())
+                {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+            job = nullptr;  // Lets go of the children before the next parent is let in
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                inFlight--;
+            }
+            finished.notify_all();
+        }
+    }
+};
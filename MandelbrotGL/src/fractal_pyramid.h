@@ -0,0 +1,105 @@
+#ifndef FRACTAL_PYRAMID_H
+#define FRACTAL_PYRAMID_H
+
+#include "fractal_engine.h"
+#include "fractal_rect.h"
+#include "fractal_scheduler.h"
+
+#include "glm.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Deep Zoom (DZI) tile pyramid of a frame, for web viewers: path.dzi describes it, and
+    // path_files/<level>/<column>_<row>.png holds the tiles, level 0 being a single pixel.
+    //
+    // Only the deepest level is rendered, one tile at a time through the callback on the calling
+    // thread. Every coarser tile is the 2x2 average of the four tiles below it, which makes the
+    // whole pyramid about 4/3 of the deepest level's cost.
+    //
+    // Tiles are built depth first in quadtree order, so each level only keeps the four tiles
+    // its next parent needs. Coloring, downsampling and writing run on a pool of threads with
+    // at most maxInFlight tiles queued or in progress; the callback blocks beyond that.
+
+    class DeepZoomPyramid
+    {
+    public:
+
+        // Pixels bottom row first, as the engines give them
+        typedef std::function<bool(const Frame& frame, std::vector<uint32_t>& pixels)> RenderTile;
+
+        struct Stats
+        {
+            int levelCount;
+            unsigned int renderedTiles;
+            unsigned int downsampledTiles;
+        };
+
+        DeepZoomPyramid(const char* path, int tileSize = 256,
+            unsigned int threadCount = TileScheduler::DefaultThreadCount(), unsigned int maxInFlight = 0);
+        ~DeepZoomPyramid();
+
+        DeepZoomPyramid(const DeepZoomPyramid&) = delete;
+        DeepZoomPyramid(DeepZoomPyramid&&) = delete;
+        DeepZoomPyramid& operator=(const DeepZoomPyramid&) = delete;
+        DeepZoomPyramid& operator=(DeepZoomPyramid&&) = delete;
+
+        // False if rendering or any write failed, the pyramid is then incomplete
+        bool Build(const Frame& frame, const RenderTile& render);
+
+        Stats LastStats() const noexcept { return { (int)levelDims.size(), renderedTiles, downsampledTiles }; }
+
+    private:
+
+        // RGB, top row first
+        struct TileImage
+        {
+            Recti rect;     // In the pixels of its level, from the top left
+            std::vector<uint8_t> rgb;
+        };
+        typedef std::shared_ptr<const TileImage> TileImagePtr;
+        typedef std::shared_future<TileImagePtr> TileFuture;
+
+        TileFuture build(int level, glm::ivec2 tile, const RenderTile& render);
+        TileImagePtr colorTile(const Recti& rect, const std::vector<uint32_t>& pixels) const;
+        TileImagePtr downsample(const Recti& rect, const TileFuture children[4]) const;
+        void writeTile(int level, const TileImage& image);
+        bool writeDescriptor() const;
+        Recti tileRect(int level, glm::ivec2 tile) const noexcept;
+
+        // Pool
+
+        TileFuture submit(std::function<TileImagePtr()> job);
+        void workerLoop();
+
+        std::string path;           // Without the ".dzi"
+        int tileSize;
+        Frame frame;
+        std::vector<glm::ivec2> levelDims;
+        std::atomic<bool> failed{ false };
+        std::atomic<unsigned int> renderedTiles{ 0 };
+        std::atomic<unsigned int> downsampledTiles{ 0 };
+
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable queued;
+        std::condition_variable finished;
+        std::deque<std::function<void()>> jobs;
+        unsigned int inFlight = 0;
+        unsigned int maxInFlight;
+        bool quit = false;
+    };
+};
+
+#endif // FRACTAL_PYRAMID_H
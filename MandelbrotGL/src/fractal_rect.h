@@ -0,0 +1,30 @@
+#ifndef FRACTAL_RECT_H
+#define FRACTAL_RECT_H
+
+#include "glm.hpp"
+
+namespace fractal
+{
+    // Rect type, x and y being the corner nearest the origin
+
+    template<typename T>
+    struct Rect {
+        T x, y, w, h;
+
+        T Right() const noexcept { return x + w; }
+        T Top() const noexcept { return y + h; }
+        bool Empty() const noexcept { return w <= 0 || h <= 0; }
+
+        // Empty if they don't overlap
+        Rect Intersect(const Rect& rhs) const noexcept
+        {
+            const T left = glm::max(x, rhs.x);
+            const T bottom = glm::max(y, rhs.y);
+            return { left, bottom, glm::min(Right(), rhs.Right()) - left, glm::min(Top(), rhs.Top()) - bottom };
+        }
+    };
+    typedef Rect<int> Recti;
+    typedef Rect<float> Rectf;
+};
+
+#endif // FRACTAL_RECT_H
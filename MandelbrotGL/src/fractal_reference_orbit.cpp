@@ -0,0 +1,76 @@
+#include "fractal_reference_orbit.h"
+
+namespace fractal
+{
+    void ReferenceOrbit::Compute(const Fixed& cx, const Fixed& cy, unsigned int iteration)
+    {
+        points.clear();
+        points.reserve(iteration);
+
+        Fixed zx(cx.LimbCount());
+        Fixed zy(cy.LimbCount());
+        points.push_back({ 0.0, 0.0 });
+
+        while (points.size() < iteration)
+        {
+            Fixed x = zx.Square() - zy.Square() + cx;
+            zy = (zx * zy).Twice() + cy;
+            zx = x;
+
+            glm::dvec2 z = { zx.ToDouble(), zy.ToDouble() };
+            points.push_back(z);
+
+            // Pixels escape at 2, keep a little past that for the ones a bit behind the reference
+            if (z.x * z.x + z.y * z.y >= 4.0)
+            {
+                break;
+            }
+        }
+    }
+
+    unsigned int PerturbedEscapeTime(const ReferenceOrbit& orbit, glm::dvec2 dc, unsigned int iteration,
+        bool detectGlitch, double& glitchDepth, unsigned int startIteration, glm::dvec2 startDelta) noexcept
+    {
+        const glm::dvec2* Z = orbit.Points().data();
+        const unsigned int length = orbit.Length();
+
+        double dzx = startDelta.x;
+        double dzy = startDelta.y;
+        double magnitude = 0.0;
+
+        for (unsigned int n = startIteration; n < iteration; n++)
+        {
+            if (n >= length)
+            {
+                // Ranked behind precision glitches: the pixel left nearest 0 makes the longest next reference
+                glitchDepth = 1.0 + magnitude;
+                return (detectGlitch) ? GLITCH : n;
+            }
+
+            const double zx = Z[n].x + dzx;
+            const double zy = Z[n].y + dzy;
+            magnitude = zx * zx + zy * zy;
+
+            if (magnitude >= 2.0)
+            {
+                return n;
+            }
+
+            if (detectGlitch)
+            {
+                const double referenceMagnitude = Z[n].x * Z[n].x + Z[n].y * Z[n].y;
+                if (magnitude < GLITCH_TOLERANCE * referenceMagnitude)
+                {
+                    glitchDepth = magnitude / referenceMagnitude;
+                    return GLITCH;
+                }
+            }
+
+            const double x = 2.0 * (Z[n].x * dzx - Z[n].y * dzy) + (dzx * dzx - dzy * dzy) + dc.x;
+            dzy = 2.0 * (Z[n].x * dzy + Z[n].y * dzx) + 2.0 * dzx * dzy + dc.y;
+            dzx = x;
+        }
+
+        return 0;
+    }
+};
@@ -0,0 +1,46 @@
+#ifndef FRACTAL_REFERENCE_ORBIT_H
+#define FRACTAL_REFERENCE_ORBIT_H
+
+#include "fractal_fixed.h"
+
+#include "glm.hpp"
+
+#include <vector>
+
+namespace fractal
+{
+    // Orbit Z(n + 1) = Z(n)^2 + C of one reference point, iterated in Fixed and stored as double.
+    // Pixels near it only iterate their difference from it: z = Z + dz, dz <- 2 Z dz + dz^2 + dc.
+    //
+    // The "z += c; z = z * z" loop of mandelbrot_cs.glsl is this orbit shifted by one step:
+    // its test on "|z|^2 < 4" at step n is "|Z(n)|^2 < 2", so escape time is the first n >= 1 with |Z(n)|^2 >= 2.
+
+    class ReferenceOrbit
+    {
+    public:
+
+        // Iterates until iteration points are stored or the reference itself escapes
+        void Compute(const Fixed& cx, const Fixed& cy, unsigned int iteration);
+
+        // Z(0) ... Z(Length() - 1)
+        const std::vector<glm::dvec2>& Points() const noexcept { return points; }
+        unsigned int Length() const noexcept { return (unsigned int)points.size(); }
+
+    private:
+
+        std::vector<glm::dvec2> points;
+    };
+
+    // Escape time of the pixel dc away from the reference, as the shader would give it.
+    // Returns GLITCH when dz lost the precision to tell the pixel from the reference
+    // (|Z + dz| much smaller than |Z|, glitchDepth below 1) or the reference escaped first (above 1).
+    // Iterating can start later than 0 from a dz given by SeriesApproximation.
+
+    constexpr unsigned int GLITCH = 0xFFFFFFFFu;
+    constexpr double GLITCH_TOLERANCE = 1e-6;   // On |Z + dz|^2 / |Z|^2
+
+    unsigned int PerturbedEscapeTime(const ReferenceOrbit& orbit, glm::dvec2 dc, unsigned int iteration,
+        bool detectGlitch, double& glitchDepth, unsigned int startIteration = 0, glm::dvec2 startDelta = { 0.0, 0.0 }) noexcept;
+};
+
+#endif // FRACTAL_REFERENCE_ORBIT_H
@@ -0,0 +1,44 @@
+#include "fractal_resolution.h"
+
+#include <math.h>
+
+namespace fractal
+{
+    DynamicResolution::DynamicResolution(glm::ivec2 fullDim, int minStep):
+        fullDim(fullDim), minStep(glm::clamp(minStep, 1, STEPS))
+    {
+    }
+
+    void DynamicResolution::Submitted(glm::ivec2 dim, double share)
+    {
+        pending.push_back({ dim, share });
+    }
+
+    void DynamicResolution::Measured(double ms)
+    {
+        if (pending.empty() == false)
+        {
+            const Pending frame = pending.front();
+            pending.pop_front();
+            Measured(frame.dim, frame.share, ms);
+        }
+    }
+
+    void DynamicResolution::Measured(glm::ivec2 dim, double share, double ms)
+    {
+        const double pixels = (double)dim.x * dim.y;
+        if (share < 0.5 || pixels <= 0.0)
+        {
+            return;
+        }
+
+        // Half the weight to the last frame: zooms change the cost quickly
+        const double framePixelMs = ms / pixels;
+        msPerPixel = (msPerPixel > 0.0) ? 0.5 * (msPerPixel + framePixelMs) : framePixelMs;
+
+        // Pixels go with the square of the step
+        const double fullMs = msPerPixel * (double)fullDim.x * fullDim.y;
+        const int fits = (int)floor(STEPS * sqrt(targetMs / glm::max(fullMs, 1e-9)));
+        step = glm::clamp(glm::min(fits, step + 1), minStep, STEPS);
+    }
+};
@@ -0,0 +1,57 @@
+#ifndef FRACTAL_RESOLUTION_H
+#define FRACTAL_RESOLUTION_H
+
+#include "glm.hpp"
+
+#include <deque>
+
+namespace fractal
+{
+    // Image dimension that keeps a frame's compute within a target time while the view moves, from
+    // the time of frames before: a cost per pixel, smoothed over frames, gives the largest dimension
+    // expected to fit. It shrinks at once and grows a step per frame, so a few cheap frames don't
+    // overshoot. Times may come frames later than their frame, as GPU timer queries do.
+
+    class DynamicResolution
+    {
+    public:
+
+        // Of the full dimension, which keeps its aspect ratio when it divides by this
+        static constexpr int STEPS = 16;
+
+        DynamicResolution(glm::ivec2 fullDim, int minStep = STEPS / 4);
+
+        void SetTargetMs(double ms) noexcept { targetMs = ms; }
+        double GetTargetMs() const noexcept { return targetMs; }
+
+        glm::ivec2 FullDim() const noexcept { return fullDim; }
+        glm::ivec2 Dim() const noexcept { return fullDim * step / STEPS; }
+        int Step() const noexcept { return step; }
+        double MsPerPixel() const noexcept { return msPerPixel; }
+
+        // A frame of dim took ms, share of its pixels computed. Frames computing less than half
+        // (pans reusing pixels, refinement going on) say little about whole ones and are skipped.
+        void Measured(glm::ivec2 dim, double share, double ms);
+
+        // The same for a frame timed later, by Measured(ms) in the order frames were submitted
+        void Submitted(glm::ivec2 dim, double share);
+        void Measured(double ms);
+
+    private:
+
+        struct Pending
+        {
+            glm::ivec2 dim;
+            double share;
+        };
+
+        glm::ivec2 fullDim;
+        int minStep;
+        int step = STEPS;
+        double targetMs = 16.6;
+        double msPerPixel = 0.0;    // 0 until a frame was measured
+        std::deque<Pending> pending;
+    };
+};
+
+#endif // FRACTAL_RESOLUTION_H
@@ -0,0 +1,221 @@
+#include "fractal_scheduler.h"
+#include "fractal_trace.h"
+#include "gl_constants.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace fractal
+{
+    // Pin thread to one logical core, so a tile's pixels stay in the same cache
+
+    static void pinToCore(std::thread& thread, unsigned int core)
+    {
+#if defined(_WIN32)
+        SetThreadAffinityMask(thread.native_handle(), (DWORD_PTR)1 << (core % (sizeof(DWORD_PTR) * 8)));
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core % CPU_SETSIZE, &set);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+
+    TileScheduler::TileScheduler(unsigned int threadCount, bool pinThreads):
+        tileSize(gl::LOCAL_WORKGROUP_SIZE, gl::LOCAL_WORKGROUP_SIZE)   // Same granularity as a shader workgroup
+    {
+        if (threadCount == 0)
+        {
+            threadCount = 1;
+        }
+
+        for (unsigned int i = 0; i < threadCount; i++)
+        {
+            queues.emplace_back(new Queue());
+        }
+
+        // The thread calling Run() works as thread 0
+        for (unsigned int i = 1; i < threadCount; i++)
+        {
+            workers.emplace_back(&TileScheduler::workerLoop, this, i);
+            if (pinThreads)
+            {
+                pinToCore(workers.back(), i);
+            }
+        }
+    }
+
+    TileScheduler::~TileScheduler()
+    {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            quit = true;
+        }
+        jobStart.notify_all();
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    unsigned int TileScheduler::DefaultThreadCount() noexcept
+    {
+        unsigned int count = std::thread::hardware_concurrency();
+        return (count == 0) ? 1 : count;
+    }
+
+    bool TileScheduler::Run(glm::ivec2 areaDim, const TileWork& work, const CancelToken* cancel)
+    {
+        std::vector<Tile> tiles;
+        for (int y = 0; y < areaDim.y; y += tileSize.y)
+        {
+            for (int x = 0; x < areaDim.x; x += tileSize.x)
+            {
+                tiles.push_back({ x, y, glm::min(tileSize.x, areaDim.x - x), glm::min(tileSize.y, areaDim.y - y) });
+            }
+        }
+
+        return Run(tiles, work, cancel);
+    }
+
+    bool TileScheduler::Run(const std::vector<Tile>& tiles, const TileWork& work, const CancelToken* cancel)
+    {
+        // Deal contiguous runs of tiles, so neighbouring tiles start on the same thread
+
+        const size_t threadCount = queues.size();
+        for (size_t i = 0; i < threadCount; i++)
+        {
+            std::lock_guard<std::mutex> lock(queues[i]->mutex);
+            queues[i]->tiles.assign(
+                tiles.begin() + tiles.size() * i / threadCount,
+                tiles.begin() + tiles.size() * (i + 1) / threadCount
+            );
+        }
+
+        this->work = &work;
+        this->cancel = cancel;
+        stealCount.store(0, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            busyWorkers = (unsigned int)workers.size();
+            jobGeneration++;
+        }
+        jobStart.notify_all();
+
+        runTiles(0);
+
+        {
+            std::unique_lock<std::mutex> lock(jobMutex);
+            jobDone.wait(lock, [this]() { return busyWorkers == 0; });
+        }
+
+        // Only a cancelled job leaves tiles behind
+        bool finished = true;
+        for (auto& queue : queues)
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            finished &= queue->tiles.empty();
+            queue->tiles.clear();
+        }
+
+        this->work = nullptr;
+        this->cancel = nullptr;
+        stats = { (unsigned int)tiles.size(), stealCount.load(std::memory_order_relaxed) };
+
+        return finished;
+    }
+
+    void TileScheduler::workerLoop(unsigned int threadIndex)
+    {
+        Trace::NameThread("Tile worker " + std::to_string(threadIndex));
+        unsigned long long seenGeneration = 0;
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(jobMutex);
+                jobStart.wait(lock, [this, seenGeneration]() { return quit || jobGeneration != seenGeneration; });
+                if (quit)
+                {
+                    return;
+                }
+                seenGeneration = jobGeneration;
+            }
+
+            runTiles(threadIndex);
+
+            {
+                std::lock_guard<std::mutex> lock(jobMutex);
+                busyWorkers--;
+                if (busyWorkers == 0)
+                {
+                    jobDone.notify_all();
+                }
+            }
+        }
+    }
+
+    void TileScheduler::runTiles(unsigned int threadIndex)
+    {
+        // No tile is added while a job runs, so once nothing is left to steal this thread is done
+
+        Tile tile;
+        while (cancel == nullptr || cancel->Cancelled() == false)
+        {
+            if (popOwn(threadIndex, tile) == false && steal(threadIndex, tile) == false)
+            {
+                break;
+            }
+
+            FRACTAL_TRACE_SCOPE("tile");
+            (*work)(tile, threadIndex);
+        }
+    }
+
+    bool TileScheduler::popOwn(unsigned int threadIndex, Tile& tile)
+    {
+        Queue& queue = *queues[threadIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.tiles.empty())
+        {
+            return false;
+        }
+
+        tile = queue.tiles.back();
+        queue.tiles.pop_back();
+        return true;
+    }
+
+    bool TileScheduler::steal(unsigned int threadIndex, Tile& tile)
+    {
+        const unsigned int threadCount = (unsigned int)queues.size();
+
+        for (unsigned int i = 1; i < threadCount; i++)
+        {
+            Queue& victim = *queues[(threadIndex + i) % threadCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+
+            if (victim.tiles.empty() == false)
+            {
+                tile = victim.tiles.front();
+                victim.tiles.pop_front();
+                stealCount.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
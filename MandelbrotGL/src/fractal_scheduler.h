@@ -0,0 +1,108 @@
+#ifndef FRACTAL_SCHEDULER_H
+#define FRACTAL_SCHEDULER_H
+
+#include "glm.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fractal
+{
+    // Set from any thread to make the frame being computed return early
+
+    class CancelToken
+    {
+    public:
+
+        void Cancel() noexcept { cancelled.store(true, std::memory_order_relaxed); }
+        void Reset() noexcept { cancelled.store(false, std::memory_order_relaxed); }
+        bool Cancelled() const noexcept { return cancelled.load(std::memory_order_relaxed); }
+
+    private:
+
+        std::atomic<bool> cancelled{ false };
+    };
+
+    struct Tile
+    {
+        int x, y, w, h;
+    };
+
+    // Splits an area into tiles and runs them on a persistent pool of threads.
+    // Each thread owns a deque of tiles: it pops from its back, and once empty steals
+    // from the front of another thread's deque, so uneven tiles (interior vs. exterior)
+    // keep every core busy until the very end of the frame.
+
+    class TileScheduler
+    {
+    public:
+
+        typedef std::function<void(const Tile& tile, unsigned int threadIndex)> TileWork;
+
+        struct Stats
+        {
+            unsigned int tileCount;
+            unsigned int stealCount;
+        };
+
+        // threadCount includes the calling thread of Run()
+        TileScheduler(unsigned int threadCount = DefaultThreadCount(), bool pinThreads = false);
+        TileScheduler(const TileScheduler& rhs) = delete;
+        TileScheduler(const TileScheduler&& rhs) = delete;
+        ~TileScheduler();
+        TileScheduler& operator=(const TileScheduler& rhs) = delete;
+        TileScheduler& operator=(const TileScheduler&& rhs) = delete;
+
+        static unsigned int DefaultThreadCount() noexcept;
+
+        unsigned int ThreadCount() const noexcept { return (unsigned int)queues.size(); }
+        void SetTileSize(glm::ivec2 size) noexcept { tileSize = size; }
+        glm::ivec2 GetTileSize() const noexcept { return tileSize; }
+        Stats LastStats() const noexcept { return stats; }
+
+        // Blocks until every tile of area is done. Returns false if cancel was set before that.
+        bool Run(glm::ivec2 areaDim, const TileWork& work, const CancelToken* cancel = nullptr);
+
+        // Same, with the tiles given explicitly
+        bool Run(const std::vector<Tile>& tiles, const TileWork& work, const CancelToken* cancel = nullptr);
+
+    private:
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Tile> tiles;
+        };
+
+        void workerLoop(unsigned int threadIndex);
+        void runTiles(unsigned int threadIndex);
+        bool popOwn(unsigned int threadIndex, Tile& tile);
+        bool steal(unsigned int threadIndex, Tile& tile);
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        glm::ivec2 tileSize;
+        Stats stats = { 0, 0 };
+
+        // Current job
+
+        std::mutex jobMutex;
+        std::condition_variable jobStart;
+        std::condition_variable jobDone;
+        unsigned long long jobGeneration = 0;
+        unsigned int busyWorkers = 0;
+        bool quit = false;
+
+        const TileWork* work = nullptr;
+        const CancelToken* cancel = nullptr;
+        std::atomic<unsigned int> stealCount{ 0 };
+    };
+};
+
+#endif // FRACTAL_SCHEDULER_H
@@ -0,0 +1,88 @@
+#include "fractal_series.h"
+
+#include <math.h>
+
+namespace fractal
+{
+    static inline glm::dvec2 complexMultiply(glm::dvec2 a, glm::dvec2 b) noexcept
+    {
+        return { a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x };
+    }
+
+    static inline double complexMagnitude(glm::dvec2 a) noexcept
+    {
+        return sqrt(a.x * a.x + a.y * a.y);
+    }
+
+    void SeriesApproximation::Compute(const ReferenceOrbit& orbit, double radius, unsigned int iteration)
+    {
+        const glm::dvec2* Z = orbit.Points().data();
+        const unsigned int last = glm::min(orbit.Length(), iteration) - 1;
+
+        terms.clear();
+        terms.push_back({ { 0.0, 0.0 }, { 0.0, 0.0 }, { 0.0, 0.0 } });
+
+        for (unsigned int n = 0; n < last; n++)
+        {
+            const Terms& t = terms.back();
+            const glm::dvec2 twoZ = 2.0 * Z[n];
+
+            Terms next = {
+                complexMultiply(twoZ, t.a) + glm::dvec2(1.0, 0.0),
+                complexMultiply(twoZ, t.b) + complexMultiply(t.a, t.a),
+                complexMultiply(twoZ, t.c) + 2.0 * complexMultiply(t.a, t.b)
+            };
+
+            // The cubic term stands for everything dropped, keep it negligible next to the linear one
+            const double linear = complexMagnitude(next.a) * radius;
+            const double cubic = complexMagnitude(next.c) * radius * radius * radius;
+            if (isfinite(linear) == false || isfinite(cubic) == false || cubic > SERIES_TOLERANCE * linear)
+            {
+                break;
+            }
+
+            terms.push_back(next);
+        }
+    }
+
+    unsigned int SeriesApproximation::ValidSkip(const ReferenceOrbit& orbit, const glm::dvec2* probes, int probeCount,
+        unsigned int skip) const noexcept
+    {
+        const glm::dvec2* Z = orbit.Points().data();
+
+        for (int i = 0; i < probeCount && skip > 0; i++)
+        {
+            const glm::dvec2 dc = probes[i];
+            glm::dvec2 dz = { 0.0, 0.0 };
+
+            for (unsigned int n = 0; n < skip; n++)
+            {
+                // Pixels check escape before stepping, so one escaping here can't skip past n
+                const glm::dvec2 z = Z[n] + dz;
+                if (z.x * z.x + z.y * z.y >= 2.0)
+                {
+                    skip = n;
+                    break;
+                }
+
+                dz = complexMultiply(2.0 * Z[n] + dz, dz) + dc;
+
+                const glm::dvec2 error = Evaluate(n + 1, dc) - dz;
+                if (complexMagnitude(error) > SERIES_TOLERANCE * complexMagnitude(dz))
+                {
+                    skip = n;
+                    break;
+                }
+            }
+        }
+
+        return skip;
+    }
+
+    glm::dvec2 SeriesApproximation::Evaluate(unsigned int n, glm::dvec2 dc) const noexcept
+    {
+        const Terms& t = terms[n];
+        const glm::dvec2 dc2 = complexMultiply(dc, dc);
+        return complexMultiply(t.a, dc) + complexMultiply(t.b, dc2) + complexMultiply(t.c, complexMultiply(dc2, dc));
+    }
+};
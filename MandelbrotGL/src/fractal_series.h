@@ -0,0 +1,50 @@
+#ifndef FRACTAL_SERIES_H
+#define FRACTAL_SERIES_H
+
+#include "fractal_reference_orbit.h"
+
+#include "glm.hpp"
+
+#include <vector>
+
+namespace fractal
+{
+    // Series approximation of perturbation: while dz is still small, every pixel's dz(n) is close to
+    // a polynomial in its dc, dz(n) ~ A(n) dc + B(n) dc^2 + C(n) dc^3, with coefficients that only
+    // depend on the reference orbit:
+    //
+    //     A <- 2 Z A + 1,    B <- 2 Z B + A^2,    C <- 2 Z C + 2 A B
+    //
+    // Pixels evaluate it once and start iterating at the skipped iteration instead of 0.
+
+    constexpr double SERIES_TOLERANCE = 1e-9;   // Relative error allowed on dz when skipping
+
+    class SeriesApproximation
+    {
+    public:
+
+        struct Terms
+        {
+            glm::dvec2 a, b, c;
+        };
+
+        // Coefficients along the orbit until the dropped terms could matter for some |dc| <= radius.
+        // Stays below orbit.Length() and iteration so pixels still have points to iterate with.
+        void Compute(const ReferenceOrbit& orbit, double radius, unsigned int iteration);
+
+        // Upper bound from the coefficients alone, before checking with probes
+        unsigned int MaxSkip() const noexcept { return (unsigned int)terms.size() - 1; }
+
+        // Lowers skip until the series agrees with plain perturbation at every probe dc
+        unsigned int ValidSkip(const ReferenceOrbit& orbit, const glm::dvec2* probes, int probeCount, unsigned int skip) const noexcept;
+
+        const Terms& TermsAt(unsigned int n) const noexcept { return terms[n]; }
+        glm::dvec2 Evaluate(unsigned int n, glm::dvec2 dc) const noexcept;
+
+    private:
+
+        std::vector<Terms> terms;
+    };
+};
+
+#endif // FRACTAL_SERIES_H
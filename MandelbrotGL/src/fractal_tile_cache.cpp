@@ -0,0 +1,209 @@
+#include "fractal_tile_cache.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace fractal
+{
+    // Rounds toward minus infinity, unlike "/"
+
+    static int64_t floorDivide(int64_t value, int64_t divisor)
+    {
+        return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    TileCache::TileCache(size_t byteBudget):
+        byteBudget(byteBudget)
+    {
+    }
+
+    TileCache::~TileCache()
+    {
+        Spill();
+    }
+
+    void TileCache::SetByteBudget(size_t bytes)
+    {
+        byteBudget = bytes;
+        evict();
+    }
+
+    bool TileCache::SetSpillFile(const char* path)
+    {
+        if (store)
+        {
+            Spill();
+            store->Close();
+            store.reset();
+        }
+        for (Entry& entry : entries)
+        {
+            entry.onDisk = false;
+        }
+
+        if (path == nullptr || path[0] == '\0')
+        {
+            return true;
+        }
+        store.reset(new TileStore(path, TILE_SIZE));
+        if (store->Good() == false)
+        {
+            store.reset();
+            return false;
+        }
+        return true;
+    }
+
+    const uint32_t* TileCache::Find(const TileKey& key)
+    {
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            entries.splice(entries.begin(), entries, found->second);
+            hits++;
+            return entries.front().pixels.data();
+        }
+
+        if (store && store->Contains(key))
+        {
+            std::vector<uint32_t> pixels((size_t)TILE_SIZE * TILE_SIZE);
+            if (store->Read(key, pixels.data()))
+            {
+                insert(key, std::move(pixels), true);
+                hits++;
+                diskHits++;
+                return entries.front().pixels.data();
+            }
+        }
+
+        misses++;
+        return nullptr;
+    }
+
+    void TileCache::Insert(const TileKey& key, const uint32_t* pixels, int stride)
+    {
+        std::vector<uint32_t> tile((size_t)TILE_SIZE * TILE_SIZE);
+        for (int y = 0; y < TILE_SIZE; y++)
+        {
+            memcpy(tile.data() + (size_t)y * TILE_SIZE, pixels + (size_t)y * stride, TILE_SIZE * sizeof(uint32_t));
+        }
+        insert(key, std::move(tile), false);
+    }
+
+    void TileCache::Spill()
+    {
+        if (store == nullptr)
+        {
+            return;
+        }
+
+        for (Entry& entry : entries)
+        {
+            if (entry.onDisk == false)
+            {
+                entry.onDisk = store->Write(entry.key, entry.pixels.data());
+            }
+        }
+    }
+
+    TileCache::Stats TileCache::GetStats() const noexcept
+    {
+        return {
+            hits, diskHits, misses, entries.size(), bytes,
+            (store) ? store->TileCount() : 0,
+            (store) ? store->FileSize() : 0
+        };
+    }
+
+    bool TileCache::OnGrid(const Frame& frame) noexcept
+    {
+        const double spacing = frame.rangeRect.z / frame.imageDim.x;
+        int exponent = 0;
+        if (frexp(spacing, &exponent) != 0.5 || frame.rangeRect.w / frame.imageDim.y != spacing)
+        {
+            return false;
+        }
+
+        // Whole pixel offsets, small enough for a double to count them exactly
+        const glm::dvec2 origin = glm::dvec2(frame.rangeRect.x, frame.rangeRect.y) / spacing;
+        return origin == glm::floor(origin) && glm::abs(origin.x) < 9.0e15 && glm::abs(origin.y) < 9.0e15;
+    }
+
+    View TileCache::Align(const View& view, glm::ivec2 imageDim)
+    {
+        const double spacing = exp2(round(log2(view.rangeX / imageDim.x)));
+        const glm::dvec2 half = glm::dvec2(imageDim) * spacing / 2.0;
+        const glm::dvec2 center = { view.centerX.ToDouble(), view.centerY.ToDouble() };
+        const glm::dvec2 aligned = glm::round((center - half) / spacing) * spacing + half;
+
+        return {
+            Fixed(aligned.x, view.centerX.LimbCount()),
+            Fixed(aligned.y, view.centerY.LimbCount()),
+            spacing * imageDim.x
+        };
+    }
+
+    std::vector<TileCache::Placement> TileCache::Layout(const Frame& frame, TileEngine engine, Precision precision, uint32_t mode)
+    {
+        const double spacing = frame.rangeRect.z / frame.imageDim.x;
+        int exponent = 0;
+        frexp(spacing, &exponent);
+
+        const int64_t originX = (int64_t)(frame.rangeRect.x / spacing);
+        const int64_t originY = (int64_t)(frame.rangeRect.y / spacing);
+        const int64_t firstX = floorDivide(originX, TILE_SIZE);
+        const int64_t firstY = floorDivide(originY, TILE_SIZE);
+        const int64_t lastX = floorDivide(originX + frame.imageDim.x - 1, TILE_SIZE);
+        const int64_t lastY = floorDivide(originY + frame.imageDim.y - 1, TILE_SIZE);
+
+        std::vector<Placement> placements;
+        for (int64_t y = firstY; y <= lastY; y++)
+        {
+            for (int64_t x = firstX; x <= lastX; x++)
+            {
+                const Recti grid = { (int)(x * TILE_SIZE - originX), (int)(y * TILE_SIZE - originY), TILE_SIZE, TILE_SIZE };
+                const Recti rect = grid.Intersect({ 0, 0, frame.imageDim.x, frame.imageDim.y });
+                placements.push_back({
+                    { exponent - 1, x, y, frame.iteration, precision, engine, mode },
+                    rect,
+                    rect.w == TILE_SIZE && rect.h == TILE_SIZE
+                });
+            }
+        }
+        return placements;
+    }
+
+    void TileCache::insert(const TileKey& key, std::vector<uint32_t>&& pixels, bool onDisk)
+    {
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            bytes -= found->second->pixels.size() * sizeof(uint32_t);
+            entries.erase(found->second);
+            index.erase(found);
+        }
+
+        bytes += pixels.size() * sizeof(uint32_t);
+        entries.push_front({ key, std::move(pixels), onDisk });
+        index[key] = entries.begin();
+        evict();
+    }
+
+    // The front one always stays, it was just asked for
+
+    void TileCache::evict()
+    {
+        while (bytes > byteBudget && entries.size() > 1)
+        {
+            Entry& last = entries.back();
+            if (last.onDisk == false && store)
+            {
+                store->Write(last.key, last.pixels.data());
+            }
+
+            bytes -= last.pixels.size() * sizeof(uint32_t);
+            index.erase(last.key);
+            entries.pop_back();
+        }
+    }
+};
@@ -0,0 +1,115 @@
+#ifndef FRACTAL_TILE_CACHE_H
+#define FRACTAL_TILE_CACHE_H
+
+#include "fractal_engine.h"
+#include "fractal_kernel.h"
+#include "fractal_rect.h"
+#include "fractal_tile_store.h"
+
+#include "glm.hpp"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace fractal
+{
+    // Least recently used escape iterations of tiles already computed, so panning back or zooming
+    // back by powers of two doesn't compute them again. Tiles sit on a grid fixed in the complex
+    // plane for each power of two pixel spacing; only frames on it (OnGrid(), Align()) can use them.
+    //
+    // Past the byte budget the least recently used tiles go. With a spill file they are written
+    // to it first, compressed (TileStore), and looked for there on a miss, which keeps them for
+    // later sessions.
+    // Not for deep zooms: grid coordinates are doubles.
+
+    class TileCache
+    {
+    public:
+
+        static constexpr int TILE_SIZE = 128;
+
+        struct Stats
+        {
+            unsigned long long hits;
+            unsigned long long diskHits;    // Counted in hits too
+            unsigned long long misses;
+            size_t tileCount;
+            size_t bytes;
+            size_t storedCount;     // In the spill file
+            uint64_t storedBytes;
+        };
+
+        // Where a tile of the grid falls in a frame, in pixels from its bottom left
+        struct Placement
+        {
+            TileKey key;
+            Recti rect;
+            bool whole;     // Tiles cut by the frame edge are computed, never cached
+        };
+
+        explicit TileCache(size_t byteBudget = 256u << 20);
+        ~TileCache();   // Spills what isn't in the spill file yet
+
+        TileCache(const TileCache&) = delete;
+        TileCache(TileCache&&) = delete;
+        TileCache& operator=(const TileCache&) = delete;
+        TileCache& operator=(TileCache&&) = delete;
+
+        void SetByteBudget(size_t bytes);
+
+        // Created if needed, empty to keep tiles in memory only. False if it can't be opened.
+        bool SetSpillFile(const char* path);
+
+        // TILE_SIZE^2 iterations, bottom row first, or nullptr on a miss.
+        // Valid until the cache is next used.
+        const uint32_t* Find(const TileKey& key);
+
+        // Copies the tile from pixels, rows stride apart
+        void Insert(const TileKey& key, const uint32_t* pixels, int stride);
+
+        // Writes every tile to the spill file, if there is one
+        void Spill();
+
+        Stats GetStats() const noexcept;
+        void ResetStats() noexcept { hits = diskHits = misses = 0; }
+
+        // Pixel spacing a power of two and pixel edges on multiples of it
+        static bool OnGrid(const Frame& frame) noexcept;
+
+        // Nearest view on the grid, its center moved by less than a pixel
+        static View Align(const View& view, glm::ivec2 imageDim);
+
+        // Grid tiles overlapping a frame on the grid, keyed for what computes them
+        static std::vector<Placement> Layout(const Frame& frame, TileEngine engine, Precision precision, uint32_t mode);
+
+    private:
+
+        struct Entry
+        {
+            TileKey key;
+            std::vector<uint32_t> pixels;
+            bool onDisk;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        void insert(const TileKey& key, std::vector<uint32_t>&& pixels, bool onDisk);
+        void evict();
+
+        EntryList entries;      // Most recently used first
+        std::unordered_map<TileKey, EntryList::iterator, TileKeyHash> index;
+        size_t byteBudget;
+        size_t bytes = 0;
+        std::unique_ptr<TileStore> store;
+
+        unsigned long long hits = 0;
+        unsigned long long diskHits = 0;
+        unsigned long long misses = 0;
+    };
+};
+
+#endif // FRACTAL_TILE_CACHE_H
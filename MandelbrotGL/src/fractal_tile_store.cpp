@@ -0,0 +1,569 @@
+#include "fractal_tile_store.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace fractal
+{
+    constexpr char STORE_MAGIC[4] = { 'M', 'T', 'I', 'L' };
+    constexpr uint32_t STORE_VERSION = 2;     // 2 keys tiles by engine and mode
+    constexpr size_t HEADER_SIZE = 32;
+    constexpr size_t INDEX_ENTRY_SIZE = 48;
+
+    // LZ77 stage: 4 byte matches found through a hash of the bytes at each position, 64 KB back at most
+
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr int HASH_BITS = 12;
+
+    static void putLittleEndian(uint8_t* out, uint64_t value, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            out[i] = (uint8_t)(value >> (8 * i));
+        }
+    }
+
+    static uint64_t getLittleEndian(const uint8_t* in, int size)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < size; i++)
+        {
+            value |= (uint64_t)in[i] << (8 * i);
+        }
+        return value;
+    }
+
+    static uint32_t read32(const uint8_t* in)
+    {
+        uint32_t value;
+        memcpy(&value, in, sizeof(value));
+        return value;
+    }
+
+    // Median of the left, lower and left + lower - lower left neighbours, in the iterations'
+    // wrapping arithmetic so any residual decodes back exactly
+
+    static uint32_t predict(const uint32_t* pixel, int x, int y, int tileSize)
+    {
+        if (y == 0)
+        {
+            return (x == 0) ? 0 : pixel[-1];
+        }
+        const uint32_t below = pixel[-tileSize];
+        if (x == 0)
+        {
+            return below;
+        }
+
+        const uint32_t left = pixel[-1];
+        const uint32_t corner = pixel[-tileSize - 1];
+        const uint32_t low = (left < below) ? left : below;
+        const uint32_t high = (left < below) ? below : left;
+        if (corner >= high)
+        {
+            return low;
+        }
+        if (corner <= low)
+        {
+            return high;
+        }
+        return left + below - corner;
+    }
+
+    static uint8_t* writeLength(uint8_t* out, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            *out++ = 255;
+        }
+        *out++ = (uint8_t)length;
+        return out;
+    }
+
+    static bool readLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (in == end)
+            {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Sequences of a token (literal count and match length - 4, 15 meaning more bytes follow),
+    // the literals, then the match's 2 byte offset back. The last sequence has literals only.
+
+    static uint8_t* writeSequence(uint8_t* out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        const size_t matchCode = (matchLength == 0) ? 0 : matchLength - MIN_MATCH;
+        uint8_t* token = out++;
+        *token = (uint8_t)((((literalCount < 15) ? literalCount : 15) << 4) | ((matchCode < 15) ? matchCode : 15));
+        if (literalCount >= 15)
+        {
+            out = writeLength(out, literalCount - 15);
+        }
+        memcpy(out, literals, literalCount);
+        out += literalCount;
+
+        if (matchLength != 0)
+        {
+            putLittleEndian(out, offset, 2);
+            out += 2;
+            if (matchCode >= 15)
+            {
+                out = writeLength(out, matchCode - 15);
+            }
+        }
+        return out;
+    }
+
+    static size_t compress(const uint8_t* in, size_t size, uint8_t* out)
+    {
+        int32_t table[1 << HASH_BITS];
+        for (int32_t& position : table)
+        {
+            position = -1;
+        }
+
+        uint8_t* start = out;
+        size_t anchor = 0;
+        size_t i = 0;
+        while (i + MIN_MATCH <= size)
+        {
+            const uint32_t bytes = read32(in + i);
+            const uint32_t hash = (bytes * 2654435761u) >> (32 - HASH_BITS);
+            const int32_t candidate = table[hash];
+            table[hash] = (int32_t)i;
+
+            if (candidate < 0 || i - candidate > MAX_OFFSET || read32(in + candidate) != bytes)
+            {
+                i++;
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while (i + length < size && in[candidate + length] == in[i + length])
+            {
+                length++;
+            }
+            out = writeSequence(out, in + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+
+        out = writeSequence(out, in + anchor, size - anchor, 0, 0);
+        return out - start;
+    }
+
+    static bool decompress(const uint8_t* in, size_t size, uint8_t* out, size_t outSize)
+    {
+        const uint8_t* end = in + size;
+        size_t written = 0;
+        while (in != end)
+        {
+            const uint8_t token = *in++;
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && readLength(in, end, literalCount) == false)
+            {
+                return false;
+            }
+            if (literalCount > (size_t)(end - in) || literalCount > outSize - written)
+            {
+                return false;
+            }
+            memcpy(out + written, in, literalCount);
+            in += literalCount;
+            written += literalCount;
+
+            if (in == end)
+            {
+                return written == outSize;
+            }
+            if (end - in < 2)
+            {
+                return false;
+            }
+            const size_t offset = (size_t)getLittleEndian(in, 2);
+            in += 2;
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && readLength(in, end, matchLength) == false)
+            {
+                return false;
+            }
+            matchLength += MIN_MATCH;
+            if (offset == 0 || offset > written || matchLength > outSize - written)
+            {
+                return false;
+            }
+
+            // Byte by byte when the match overlaps what it writes, which is how runs are coded
+            const uint8_t* from = out + written - offset;
+            uint8_t* to = out + written;
+            if (offset >= matchLength)
+            {
+                memcpy(to, from, matchLength);
+            }
+            else
+            {
+                for (size_t i = 0; i < matchLength; i++)
+                {
+                    to[i] = from[i];
+                }
+            }
+            written += matchLength;
+        }
+
+        // Ended on a match: the sequence of literals that closes the stream is missing
+        return false;
+    }
+
+    TileStore::TileStore(const char* path, int tileSize):
+        path(path),
+        tileSize(tileSize)
+    {
+        file = fopen(path, "r+b");
+        if (file == nullptr)
+        {
+            file = fopen(path, "w+b");
+            if (file == nullptr)
+            {
+                printf("Error: can't create the tile store %s\n", path);
+                return;
+            }
+
+            // An empty store until the first Close() writes an index
+            uint8_t header[HEADER_SIZE] = {};
+            memcpy(header, STORE_MAGIC, 4);
+            putLittleEndian(header + 4, STORE_VERSION, 4);
+            putLittleEndian(header + 8, (uint64_t)tileSize, 4);
+            writeBytes(header, HEADER_SIZE);
+            fileEnd = HEADER_SIZE;
+            fflush(file);
+        }
+        else
+        {
+#ifdef _WIN32
+            _fseeki64(file, 0, SEEK_END);
+            fileEnd = (uint64_t)_ftelli64(file);
+#else
+            fseeko(file, 0, SEEK_END);
+            fileEnd = (uint64_t)ftello(file);
+#endif
+        }
+
+        if (failed || map() == false || readIndex() == false)
+        {
+            unmap();
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    TileStore::~TileStore()
+    {
+        Close();
+    }
+
+    bool TileStore::Read(const TileKey& key, uint32_t* pixels)
+    {
+        auto found = index.find(key);
+        if (found == index.end())
+        {
+            return false;
+        }
+
+        // Tiles written since the file was mapped need a larger mapping
+        const Location& location = found->second;
+        if (location.offset + location.size > mappedSize)
+        {
+            fflush(file);
+            if (map() == false)
+            {
+                return false;
+            }
+        }
+        return Decode(mapped + location.offset, location.size, tileSize, residuals, pixels);
+    }
+
+    bool TileStore::Write(const TileKey& key, const uint32_t* pixels)
+    {
+        if (Good() == false)
+        {
+            return false;
+        }
+
+        Encode(pixels, tileSize, residuals, encoded);
+        if (seek(fileEnd) == false)
+        {
+            return false;
+        }
+        writeBytes(encoded.data(), encoded.size());
+        if (failed)
+        {
+            return false;
+        }
+
+        index[key] = { fileEnd, (uint32_t)encoded.size() };
+        fileEnd += encoded.size();
+        written = true;
+        return true;
+    }
+
+    bool TileStore::Close()
+    {
+        if (file == nullptr)
+        {
+            return false;
+        }
+
+        // Index after the last tile, then the header pointing at it
+        if (written && failed == false)
+        {
+            std::vector<uint8_t> entries(index.size() * INDEX_ENTRY_SIZE, 0);
+            uint8_t* out = entries.data();
+            for (const auto& tile : index)
+            {
+                putLittleEndian(out, (uint32_t)tile.first.level, 4);
+                putLittleEndian(out + 4, (uint32_t)tile.first.iteration, 4);
+                putLittleEndian(out + 8, (uint32_t)tile.first.precision, 4);
+                putLittleEndian(out + 12, (uint32_t)tile.first.engine, 4);
+                putLittleEndian(out + 16, (uint64_t)tile.first.x, 8);
+                putLittleEndian(out + 24, (uint64_t)tile.first.y, 8);
+                putLittleEndian(out + 32, tile.second.offset, 8);
+                putLittleEndian(out + 40, tile.second.size, 4);
+                putLittleEndian(out + 44, tile.first.mode, 4);
+                out += INDEX_ENTRY_SIZE;
+            }
+
+            const uint64_t indexAt = fileEnd;
+            if (seek(indexAt))
+            {
+                writeBytes(entries.data(), entries.size());
+            }
+            fflush(file);
+
+            uint8_t locations[16];
+            putLittleEndian(locations, indexAt, 8);
+            putLittleEndian(locations + 8, index.size(), 8);
+            if (seek(16))
+            {
+                writeBytes(locations, sizeof(locations));
+            }
+        }
+
+        unmap();
+        const bool closed = (fclose(file) == 0) && (failed == false);
+        file = nullptr;
+        if (closed == false)
+        {
+            printf("Error: can't write the tile store %s\n", path.c_str());
+        }
+        return closed;
+    }
+
+    // Varint residuals first, then LZ77 over them, their size in front
+
+    void TileStore::Encode(const uint32_t* pixels, int tileSize, std::vector<uint8_t>& residuals, std::vector<uint8_t>& encoded)
+    {
+        const size_t pixelCount = (size_t)tileSize * tileSize;
+        residuals.resize(pixelCount * 5);
+        uint8_t* out = residuals.data();
+        for (int y = 0; y < tileSize; y++)
+        {
+            const uint32_t* row = pixels + (size_t)y * tileSize;
+            for (int x = 0; x < tileSize; x++)
+            {
+                const int32_t residual = (int32_t)(row[x] - predict(row + x, x, y, tileSize));
+                uint32_t value = ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+                for (; value >= 0x80; value >>= 7)
+                {
+                    *out++ = (uint8_t)(value | 0x80);
+                }
+                *out++ = (uint8_t)value;
+            }
+        }
+        const size_t residualSize = out - residuals.data();
+
+        // Worst case all literals: one length byte per 255 of them, a token and the size
+        encoded.resize(4 + 1 + residualSize + residualSize / 255 + 1);
+        putLittleEndian(encoded.data(), residualSize, 4);
+        encoded.resize(4 + compress(residuals.data(), residualSize, encoded.data() + 4));
+    }
+
+    bool TileStore::Decode(const uint8_t* encoded, size_t size, int tileSize, std::vector<uint8_t>& residuals, uint32_t* pixels)
+    {
+        const size_t pixelCount = (size_t)tileSize * tileSize;
+        if (size < 4)
+        {
+            return false;
+        }
+        const size_t residualSize = (size_t)getLittleEndian(encoded, 4);
+        if (residualSize < pixelCount || residualSize > pixelCount * 5)
+        {
+            return false;
+        }
+
+        residuals.resize(residualSize);
+        if (decompress(encoded + 4, size - 4, residuals.data(), residualSize) == false)
+        {
+            return false;
+        }
+
+        const uint8_t* in = residuals.data();
+        const uint8_t* end = in + residualSize;
+        for (int y = 0; y < tileSize; y++)
+        {
+            uint32_t* row = pixels + (size_t)y * tileSize;
+            for (int x = 0; x < tileSize; x++)
+            {
+                uint32_t value = 0;
+                for (int shift = 0; ; shift += 7)
+                {
+                    if (in == end || shift > 28)
+                    {
+                        return false;
+                    }
+                    const uint8_t byte = *in++;
+                    value |= (uint32_t)(byte & 0x7f) << shift;
+                    if ((byte & 0x80) == 0)
+                    {
+                        break;
+                    }
+                }
+                const uint32_t residual = (value >> 1) ^ (0u - (value & 1));
+                row[x] = predict(row + x, x, y, tileSize) + residual;
+            }
+        }
+        return in == end;
+    }
+
+    bool TileStore::readIndex()
+    {
+        if (mappedSize < HEADER_SIZE || memcmp(mapped, STORE_MAGIC, 4) != 0)
+        {
+            printf("Error: %s is not a tile store\n", path.c_str());
+            return false;
+        }
+        if (getLittleEndian(mapped + 4, 4) != STORE_VERSION || getLittleEndian(mapped + 8, 4) != (uint64_t)tileSize)
+        {
+            printf("Error: the tile store %s is of another version or tile size\n", path.c_str());
+            return false;
+        }
+
+        const uint64_t indexAt = getLittleEndian(mapped + 16, 8);
+        const uint64_t tileCount = getLittleEndian(mapped + 24, 8);
+        if (tileCount == 0)
+        {
+            return true;
+        }
+        if (indexAt < HEADER_SIZE || indexAt > mappedSize || tileCount > (mappedSize - indexAt) / INDEX_ENTRY_SIZE)
+        {
+            printf("Error: the tile store %s has a damaged index\n", path.c_str());
+            return false;
+        }
+
+        const uint8_t* in = mapped + indexAt;
+        for (uint64_t i = 0; i < tileCount; i++, in += INDEX_ENTRY_SIZE)
+        {
+            const TileKey key = {
+                (int)(int32_t)getLittleEndian(in, 4),
+                (int64_t)getLittleEndian(in + 16, 8),
+                (int64_t)getLittleEndian(in + 24, 8),
+                (int)(int32_t)getLittleEndian(in + 4, 4),
+                (Precision)getLittleEndian(in + 8, 4),
+                (TileEngine)getLittleEndian(in + 12, 4),
+                (uint32_t)getLittleEndian(in + 44, 4)
+            };
+            const Location location = { getLittleEndian(in + 32, 8), (uint32_t)getLittleEndian(in + 40, 4) };
+            if (location.offset < HEADER_SIZE || location.offset + location.size > indexAt)
+            {
+                printf("Error: the tile store %s has a damaged index\n", path.c_str());
+                index.clear();
+                return false;
+            }
+            index[key] = location;
+        }
+        return true;
+    }
+
+    bool TileStore::map()
+    {
+        unmap();
+#ifdef _WIN32
+        const HANDLE handle = (HANDLE)_get_osfhandle(_fileno(file));
+        mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* view = (mapping) ? MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (view == nullptr)
+        {
+            unmap();
+            printf("Error: can't map the tile store %s\n", path.c_str());
+            return false;
+        }
+#else
+        void* view = mmap(nullptr, (size_t)fileEnd, PROT_READ, MAP_SHARED, fileno(file), 0);
+        if (view == MAP_FAILED)
+        {
+            printf("Error: can't map the tile store %s\n", path.c_str());
+            return false;
+        }
+#endif
+        mapped = (const uint8_t*)view;
+        mappedSize = fileEnd;
+        return true;
+    }
+
+    void TileStore::unmap()
+    {
+#ifdef _WIN32
+        if (mapped)
+        {
+            UnmapViewOfFile(mapped);
+        }
+        if (mapping)
+        {
+            CloseHandle((HANDLE)mapping);
+            mapping = nullptr;
+        }
+#else
+        if (mapped)
+        {
+            munmap((void*)mapped, (size_t)mappedSize);
+        }
+#endif
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+
+    bool TileStore::seek(uint64_t offset)
+    {
+#ifdef _WIN32
+        const bool sought = (_fseeki64(file, (long long)offset, SEEK_SET) == 0);
+#else
+        const bool sought = (fseeko(file, (off_t)offset, SEEK_SET) == 0);
+#endif
+        failed = failed || (sought == false);
+        return sought;
+    }
+
+    void TileStore::writeBytes(const void* data, size_t size)
+    {
+        if (fwrite(data, 1, size, file) != size)
+        {
+            failed = true;
+        }
+    }
+};
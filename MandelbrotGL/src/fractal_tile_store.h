@@ -0,0 +1,149 @@
+#ifndef FRACTAL_TILE_STORE_H
+#define FRACTAL_TILE_STORE_H
+
+#include "fractal_kernel.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace fractal
+{
+    // What computed a tile. CPU kernels of different ISAs and the GPU may round differently,
+    // so a tile of one doesn't stand in for another's without a seam.
+    enum class TileEngine
+    {
+        CPU_SCALAR, CPU_SSE2, CPU_AVX2, CPU_AVX512,     // In the order of Isa
+        GPU
+    };
+
+    inline TileEngine CpuTileEngine(Isa isa) noexcept { return (TileEngine)((int)TileEngine::CPU_SCALAR + (int)isa); }
+
+    // Settings of the engine that change its pixels, or 0 when it computes every one exactly
+    enum TileMode : uint32_t
+    {
+        TILE_SUBDIVISION = 1u << 0,     // Rectangles with an uniform border filled, not computed
+        TILE_INTERIOR_CHECKS = 1u << 1  // Orbits ended when found periodic, within a tolerance
+    };
+
+    // One tile of the cache grid: tileSize pixels of spacing 2^level on each side, the one
+    // with its bottom left pixel at (x, y) * tileSize * 2^level in the complex plane
+
+    struct TileKey
+    {
+        int level;
+        int64_t x, y;
+        int iteration;
+        Precision precision;
+        TileEngine engine;
+        uint32_t mode;      // TileMode flags
+
+        bool operator==(const TileKey& rhs) const noexcept
+        {
+            return level == rhs.level && x == rhs.x && y == rhs.y && iteration == rhs.iteration && precision == rhs.precision &&
+                engine == rhs.engine && mode == rhs.mode;
+        }
+    };
+
+    struct TileKeyHash
+    {
+        size_t operator()(const TileKey& key) const noexcept
+        {
+            uint64_t hash = 14695981039346656037ull;
+            const uint64_t values[7] = {
+                (uint64_t)key.level, (uint64_t)key.x, (uint64_t)key.y, (uint64_t)key.iteration, (uint64_t)key.precision,
+                (uint64_t)key.engine, (uint64_t)key.mode
+            };
+            for (uint64_t value : values)
+            {
+                hash = (hash ^ value) * 1099511628211ull;
+            }
+            return (size_t)hash;
+        }
+    };
+
+    // File of compressed iteration tiles, read through a memory mapping so that tiles aren't copied
+    // out of the page cache before decoding. The LZ77 stage decodes to a buffer of the store, reused
+    // between tiles, and the residuals from there into whatever buffer the caller gives.
+    //
+    // Layout, little endian: a 32 byte header (magic "MTIL", version, tile size, tile count and
+    // where the index is), the tiles one after another, then the index of where each one is.
+    // New tiles are appended after the last index and a new one written on Close(), so a session
+    // that never closes leaves the file as it was.
+    //
+    // Each tile is coded in two steps. Iterations are predicted from their left, lower and lower
+    // left neighbours (LOCO-I's median predictor), which turns the smooth bands of the set into
+    // residuals near 0, written as zigzag varints. Those bytes then go through a small LZ77 coder,
+    // LZ4-like tokens with 64 KB of history, which mostly folds away the runs of equal residuals
+    // inside the set and far outside it.
+
+    class TileStore
+    {
+    public:
+
+        // Opens path, or creates it if it doesn't exist
+        TileStore(const char* path, int tileSize);
+        ~TileStore();
+
+        TileStore(const TileStore&) = delete;
+        TileStore(TileStore&&) = delete;
+        TileStore& operator=(const TileStore&) = delete;
+        TileStore& operator=(TileStore&&) = delete;
+
+        bool Good() const noexcept { return file != nullptr && failed == false; }
+
+        bool Contains(const TileKey& key) const { return index.count(key) != 0; }
+        size_t TileCount() const noexcept { return index.size(); }
+        uint64_t FileSize() const noexcept { return fileEnd; }
+
+        // tileSize^2 iterations, bottom row first. False if the tile isn't there or is damaged.
+        bool Read(const TileKey& key, uint32_t* pixels);
+
+        // Appends the tile, replacing any with the same key
+        bool Write(const TileKey& key, const uint32_t* pixels);
+
+        // Writes the index. False if anything failed since the store was opened.
+        bool Close();
+
+        // The codec alone, for MandelbrotTests. residuals is scratch space, kept between calls.
+        static void Encode(const uint32_t* pixels, int tileSize, std::vector<uint8_t>& residuals, std::vector<uint8_t>& encoded);
+        static bool Decode(const uint8_t* encoded, size_t size, int tileSize, std::vector<uint8_t>& residuals, uint32_t* pixels);
+
+    private:
+
+        struct Location
+        {
+            uint64_t offset;
+            uint32_t size;
+        };
+
+        bool readIndex();
+        bool map();
+        void unmap();
+        bool seek(uint64_t offset);
+        void writeBytes(const void* data, size_t size);
+
+        std::string path;
+        FILE* file = nullptr;
+        int tileSize;
+        bool failed = false;
+        bool written = false;       // Tiles appended, the index needs writing
+        std::unordered_map<TileKey, Location, TileKeyHash> index;
+        uint64_t fileEnd = 0;
+
+        // Mapping of the file, up to mappedSize
+        const uint8_t* mapped = nullptr;
+        uint64_t mappedSize = 0;
+#ifdef _WIN32
+        void* mapping = nullptr;
+#endif
+
+        std::vector<uint8_t> residuals;     // Reused between tiles
+        std::vector<uint8_t> encoded;
+    };
+};
+
+#endif // FRACTAL_TILE_STORE_H
@@ -0,0 +1,306 @@
+#include "fractal_tiled_image.h"
+#include "fractal_palette.h"
+
+namespace fractal
+{
+    // BigTIFF field types and tags, as few as a baseline reader needs
+
+    constexpr uint16_t TIFF_SHORT = 3;
+    constexpr uint16_t TIFF_LONG = 4;
+    constexpr uint16_t TIFF_LONG8 = 16;
+
+    constexpr uint16_t TAG_IMAGE_WIDTH = 256;
+    constexpr uint16_t TAG_IMAGE_LENGTH = 257;
+    constexpr uint16_t TAG_BITS_PER_SAMPLE = 258;
+    constexpr uint16_t TAG_COMPRESSION = 259;
+    constexpr uint16_t TAG_PHOTOMETRIC = 262;
+    constexpr uint16_t TAG_SAMPLES_PER_PIXEL = 277;
+    constexpr uint16_t TAG_PLANAR_CONFIGURATION = 284;
+    constexpr uint16_t TAG_TILE_WIDTH = 322;
+    constexpr uint16_t TAG_TILE_LENGTH = 323;
+    constexpr uint16_t TAG_TILE_OFFSETS = 324;
+    constexpr uint16_t TAG_TILE_BYTE_COUNTS = 325;
+
+    constexpr size_t BIGTIFF_HEADER_SIZE = 16;
+
+    static void putLittleEndian(uint8_t* out, uint64_t value, int size)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            out[i] = (uint8_t)(value >> (8 * i));
+        }
+    }
+
+    TiledImageWriter::TiledImageWriter(const char* path, ImageFormat format, glm::ivec2 dim, glm::ivec2 tileDim, int iteration,
+        unsigned int queueCapacity):
+        file(nullptr),
+        format(format),
+        dim(dim),
+        tileDim(tileDim),
+        tileCount((dim + tileDim - 1) / tileDim),
+        iteration(iteration),
+        queueCapacity((queueCapacity == 0) ? 1 : queueCapacity)
+    {
+        if (format != ImageFormat::TIFF && format != ImageFormat::RAW)
+        {
+            printf("Error: tiles are only written to TIFF or raw\n");
+            return;
+        }
+        if (format == ImageFormat::TIFF && (tileDim.x % 16 != 0 || tileDim.y % 16 != 0))
+        {
+            printf("Error: TIFF tiles have to be a multiple of 16 pixels\n");
+            return;
+        }
+
+        file = fopen(path, "wb");
+        if (file == nullptr)
+        {
+            printf("Error: can't open %s for writing\n", path);
+            return;
+        }
+
+        if (format == ImageFormat::TIFF)
+        {
+            // Little endian, version 43, 8 byte offsets, then the directory offset Close() fills in
+            uint8_t header[BIGTIFF_HEADER_SIZE] = { 'I', 'I', 43, 0, 8, 0, 0, 0 };
+            writeBytes(header, sizeof(header));
+            fileEnd = BIGTIFF_HEADER_SIZE;
+
+            tileOffsets.resize((size_t)tileCount.x * tileCount.y, 0);
+            tileByteCounts.resize(tileOffsets.size(), 0);
+        }
+
+        writer = std::thread(&TiledImageWriter::writerLoop, this);
+    }
+
+    TiledImageWriter::~TiledImageWriter()
+    {
+        if (writer.joinable())
+        {
+            Close();
+        }
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+
+    void TiledImageWriter::Push(glm::ivec2 tile, std::vector<uint32_t>&& pixels)
+    {
+        if (writer.joinable() == false)
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        popped.wait(lock, [this]() { return queue.size() < queueCapacity; });
+        queue.push_back({ tile, std::move(pixels) });
+        pushed.notify_one();
+    }
+
+    bool TiledImageWriter::Close()
+    {
+        if (writer.joinable() == false)
+        {
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        pushed.notify_one();
+        writer.join();
+
+        const unsigned int tiles = (unsigned int)(tileCount.x * tileCount.y);
+        if (tilesWritten != tiles)
+        {
+            printf("Error: image closed with %u of its %u tiles\n", tilesWritten, tiles);
+            failed = true;
+        }
+        else if (format == ImageFormat::TIFF)
+        {
+            writeTiffDirectory();
+        }
+
+        failed = failed || (fclose(file) != 0);
+        file = nullptr;
+        return failed == false;
+    }
+
+    void TiledImageWriter::writerLoop()
+    {
+        while (true)
+        {
+            Pending pending;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                pushed.wait(lock, [this]() { return queue.empty() == false || closing; });
+                if (queue.empty())
+                {
+                    return;
+                }
+                pending = std::move(queue.front());
+                queue.pop_front();
+            }
+            popped.notify_one();
+
+            if (failed)
+            {
+                continue;   // Keep draining so Push() never blocks for good
+            }
+            if (format == ImageFormat::TIFF)
+            {
+                writeTiff(pending);
+            }
+            else
+            {
+                writeRaw(pending);
+            }
+            tilesWritten++;
+        }
+    }
+
+    void TiledImageWriter::writeTiff(const Pending& pending)
+    {
+        const glm::ivec2 size = TileDim(pending.tile);
+        encoded.assign((size_t)tileDim.x * tileDim.y * 3, 0);
+
+        for (int y = 0; y < size.y; y++)
+        {
+            const uint32_t* in = pending.pixels.data() + (size_t)(size.y - 1 - y) * size.x;
+            uint8_t* out = encoded.data() + (size_t)y * tileDim.x * 3;
+            for (int x = 0; x < size.x; x++, out += 3)
+            {
+                const glm::u8vec3 color = PaletteColor(PaletteShade(in[x], iteration));
+                out[0] = color.r;
+                out[1] = color.g;
+                out[2] = color.b;
+            }
+        }
+
+        // Appended in the order they come, the directory says where each one went
+        const size_t index = (size_t)pending.tile.y * tileCount.x + pending.tile.x;
+        tileOffsets[index] = fileEnd;
+        tileByteCounts[index] = encoded.size();
+
+        if (seek(fileEnd))
+        {
+            writeBytes(encoded.data(), encoded.size());
+        }
+        fileEnd += encoded.size();
+    }
+
+    void TiledImageWriter::writeRaw(const Pending& pending)
+    {
+        const glm::ivec2 offset = TileOffset(pending.tile);
+        const glm::ivec2 size = TileDim(pending.tile);
+        encoded.resize((size_t)size.x * 4);
+
+        for (int y = 0; y < size.y && failed == false; y++)
+        {
+            const uint32_t* in = pending.pixels.data() + (size_t)(size.y - 1 - y) * size.x;
+            for (int x = 0; x < size.x; x++)
+            {
+                putLittleEndian(encoded.data() + (size_t)x * 4, in[x], 4);
+            }
+
+            if (seek(((uint64_t)(offset.y + y) * dim.x + offset.x) * 4))
+            {
+                writeBytes(encoded.data(), encoded.size());
+            }
+        }
+    }
+
+    // One image file directory after the tiles, then its offset into the header
+
+    void TiledImageWriter::writeTiffDirectory()
+    {
+        struct Entry
+        {
+            uint16_t tag;
+            uint16_t type;
+            uint64_t count;
+            uint64_t value;     // Or offset, when count values don't fit in 8 bytes
+        };
+
+        const uint64_t tiles = tileOffsets.size();
+        uint64_t offsetsAt = tileOffsets[0];
+        uint64_t byteCountsAt = tileByteCounts[0];
+
+        // Arrays of more than one LONG8 go before the directory, 8 byte aligned
+        fileEnd = (fileEnd + 7) & ~7ull;
+        if (tiles > 1 && seek(fileEnd))
+        {
+            encoded.resize(tiles * 8);
+            for (uint64_t i = 0; i < tiles; i++) putLittleEndian(encoded.data() + i * 8, tileOffsets[i], 8);
+            writeBytes(encoded.data(), encoded.size());
+            offsetsAt = fileEnd;
+
+            for (uint64_t i = 0; i < tiles; i++) putLittleEndian(encoded.data() + i * 8, tileByteCounts[i], 8);
+            writeBytes(encoded.data(), encoded.size());
+            byteCountsAt = fileEnd + tiles * 8;
+
+            fileEnd += tiles * 16;
+        }
+
+        const Entry entries[] = {   // Sorted by tag
+            { TAG_IMAGE_WIDTH, TIFF_LONG, 1, (uint64_t)dim.x },
+            { TAG_IMAGE_LENGTH, TIFF_LONG, 1, (uint64_t)dim.y },
+            { TAG_BITS_PER_SAMPLE, TIFF_SHORT, 3, 0x000800080008ull },      // 8, 8, 8
+            { TAG_COMPRESSION, TIFF_SHORT, 1, 1 },          // None
+            { TAG_PHOTOMETRIC, TIFF_SHORT, 1, 2 },          // RGB
+            { TAG_SAMPLES_PER_PIXEL, TIFF_SHORT, 1, 3 },
+            { TAG_PLANAR_CONFIGURATION, TIFF_SHORT, 1, 1 }, // Interleaved
+            { TAG_TILE_WIDTH, TIFF_LONG, 1, (uint64_t)tileDim.x },
+            { TAG_TILE_LENGTH, TIFF_LONG, 1, (uint64_t)tileDim.y },
+            { TAG_TILE_OFFSETS, TIFF_LONG8, tiles, offsetsAt },
+            { TAG_TILE_BYTE_COUNTS, TIFF_LONG8, tiles, byteCountsAt }
+        };
+        const size_t entryCount = sizeof(entries) / sizeof(Entry);
+
+        encoded.assign(8 + entryCount * 20 + 8, 0);
+        putLittleEndian(encoded.data(), entryCount, 8);
+        for (size_t i = 0; i < entryCount; i++)
+        {
+            uint8_t* out = encoded.data() + 8 + i * 20;
+            putLittleEndian(out, entries[i].tag, 2);
+            putLittleEndian(out + 2, entries[i].type, 2);
+            putLittleEndian(out + 4, entries[i].count, 8);
+            putLittleEndian(out + 12, entries[i].value, 8);
+        }
+        // Last 8 bytes stay 0: no next directory
+
+        const uint64_t directoryAt = fileEnd;
+        if (seek(directoryAt))
+        {
+            writeBytes(encoded.data(), encoded.size());
+        }
+
+        uint8_t directoryOffset[8];
+        putLittleEndian(directoryOffset, directoryAt, 8);
+        if (seek(8))
+        {
+            writeBytes(directoryOffset, 8);
+        }
+    }
+
+    bool TiledImageWriter::seek(uint64_t offset)
+    {
+#ifdef _WIN32
+        const bool sought = (_fseeki64(file, (long long)offset, SEEK_SET) == 0);
+#else
+        const bool sought = (fseeko(file, (off_t)offset, SEEK_SET) == 0);
+#endif
+        failed = failed || (sought == false);
+        return sought;
+    }
+
+    void TiledImageWriter::writeBytes(const void* data, size_t size)
+    {
+        if (fwrite(data, 1, size, file) != size)
+        {
+            failed = true;
+        }
+    }
+};
@@ -0,0 +1,98 @@
+#ifndef FRACTAL_TILED_IMAGE_H
+#define FRACTAL_TILED_IMAGE_H
+
+#include "fractal_image.h"
+
+#include "glm.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace fractal
+{
+    // Writes an image too big to hold, tile by tile as they get computed, in any order.
+    // Tiles are counted in a grid of tileDim from the top left, the edge ones being smaller;
+    // their pixels come bottom row first, as the engines give them.
+    //
+    // Push() hands a tile over to a thread of its own, which colors and writes it while the
+    // caller computes the next ones. At most queueCapacity tiles wait, Push() blocks beyond that,
+    // so memory stays at a few tiles whatever the image size.
+    //
+    // TIFF is a BigTIFF of tileDim RGB tiles, edge ones padded with black, tileDim being a multiple
+    // of 16. RAW is the same file ImageWriter makes, each tile row written in place.
+
+    class TiledImageWriter
+    {
+    public:
+
+        TiledImageWriter(const char* path, ImageFormat format, glm::ivec2 dim, glm::ivec2 tileDim, int iteration,
+            unsigned int queueCapacity = 4);
+        ~TiledImageWriter();
+
+        TiledImageWriter(const TiledImageWriter&) = delete;
+        TiledImageWriter(TiledImageWriter&&) = delete;
+        TiledImageWriter& operator=(const TiledImageWriter&) = delete;
+        TiledImageWriter& operator=(TiledImageWriter&&) = delete;
+
+        bool Good() const noexcept { return file != nullptr && failed == false; }
+
+        glm::ivec2 TileCount() const noexcept { return tileCount; }
+
+        // Pixel offset and size of tile, from the top left
+        glm::ivec2 TileOffset(glm::ivec2 tile) const noexcept { return tile * tileDim; }
+        glm::ivec2 TileDim(glm::ivec2 tile) const noexcept { return glm::min(tileDim, dim - tile * tileDim); }
+
+        // Takes the pixels over, pixels.size() being TileDim(tile).x * TileDim(tile).y
+        void Push(glm::ivec2 tile, std::vector<uint32_t>&& pixels);
+
+        // Waits for the queue to drain. False if a write failed or tiles are missing.
+        bool Close();
+
+    private:
+
+        struct Pending
+        {
+            glm::ivec2 tile;
+            std::vector<uint32_t> pixels;
+        };
+
+        void writerLoop();
+        void writeTiff(const Pending& pending);
+        void writeRaw(const Pending& pending);
+        void writeTiffDirectory();
+        bool seek(uint64_t offset);
+        void writeBytes(const void* data, size_t size);
+
+        FILE* file;
+        ImageFormat format;
+        glm::ivec2 dim;
+        glm::ivec2 tileDim;
+        glm::ivec2 tileCount;
+        int iteration;
+        std::atomic<bool> failed{ false };
+
+        std::vector<uint8_t> encoded;   // Tile or row bytes, reused
+        std::vector<uint64_t> tileOffsets;
+        std::vector<uint64_t> tileByteCounts;
+        uint64_t fileEnd = 0;
+        unsigned int tilesWritten = 0;
+
+        // Queue
+
+        std::mutex mutex;
+        std::condition_variable pushed;
+        std::condition_variable popped;
+        std::deque<Pending> queue;
+        unsigned int queueCapacity;
+        bool closing = false;
+        std::thread writer;
+    };
+};
+
+#endif // FRACTAL_TILED_IMAGE_H
@@ -0,0 +1,182 @@
+#include "fractal_trace.h"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdio.h>
+
+namespace fractal
+{
+    struct TraceEvent
+    {
+        const char* name;
+        double beginUs;
+        double durationUs;
+    };
+
+    struct TraceTrack
+    {
+        int id;
+        std::string name;
+        std::mutex mutex;       // Only taken by others while writing or starting over
+        std::vector<TraceEvent> events;     // Ring of the last EVENTS_PER_TRACK, next one at added % size
+        unsigned long long added = 0;
+    };
+
+    std::atomic<bool> Trace::enabled{ false };
+
+    static std::atomic<long long> originNs{ 0 };        // Of the steady clock, at Start()
+    static std::mutex tracksMutex;
+    static std::vector<std::unique_ptr<TraceTrack>> tracks;     // Track id - 1
+    static thread_local TraceTrack* threadTrack = nullptr;
+
+    static TraceTrack* addTrack(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        tracks.emplace_back(new TraceTrack());
+        TraceTrack* track = tracks.back().get();
+        track->id = (int)tracks.size();
+        track->name = name.empty() ? "Thread " + std::to_string(track->id) : name;
+        return track;
+    }
+
+    static void addEvent(TraceTrack& track, const char* name, double beginUs, double endUs)
+    {
+        std::lock_guard<std::mutex> lock(track.mutex);
+        const TraceEvent event = { name, beginUs, endUs - beginUs };
+        if (track.events.size() < Trace::EVENTS_PER_TRACK)
+        {
+            track.events.push_back(event);
+        }
+        else
+        {
+            track.events[track.added % Trace::EVENTS_PER_TRACK] = event;
+        }
+        track.added++;
+    }
+
+    // JSON strings, for names that could hold quotes or backslashes
+    static void writeString(FILE* file, const char* text)
+    {
+        fputc('"', file);
+        for (const char* c = text; *c; c++)
+        {
+            if (*c == '"' || *c == '\\') fputc('\\', file);
+            if ((unsigned char)*c >= 0x20) fputc(*c, file);
+        }
+        fputc('"', file);
+    }
+
+    void Trace::Start()
+    {
+        {
+            std::lock_guard<std::mutex> lock(tracksMutex);
+            for (auto& track : tracks)
+            {
+                std::lock_guard<std::mutex> trackLock(track->mutex);
+                track->events.clear();
+                track->added = 0;
+            }
+        }
+
+        originNs.store(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count(), std::memory_order_relaxed);
+        enabled.store(true, std::memory_order_relaxed);
+    }
+
+    double Trace::NowUs() noexcept
+    {
+        const long long nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        return (double)(nowNs - originNs.load(std::memory_order_relaxed)) / 1000.0;
+    }
+
+    // Also places the thread's track, which sorts by first appearance
+    void Trace::NameThread(const std::string& name)
+    {
+        if (threadTrack == nullptr)
+        {
+            threadTrack = addTrack(name);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(threadTrack->mutex);
+        threadTrack->name = name;
+    }
+
+    int Trace::AddTrack(const std::string& name)
+    {
+        return addTrack(name)->id;
+    }
+
+    void Trace::Complete(const char* name, double beginUs, double endUs)
+    {
+        if (threadTrack == nullptr)
+        {
+            threadTrack = addTrack("");
+        }
+        addEvent(*threadTrack, name, beginUs, endUs);
+    }
+
+    void Trace::Complete(int track, const char* name, double beginUs, double endUs)
+    {
+        TraceTrack* target = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(tracksMutex);
+            if (track < 1 || track > (int)tracks.size())
+            {
+                return;
+            }
+            target = tracks[track - 1].get();
+        }
+        addEvent(*target, name, beginUs, endUs);
+    }
+
+    bool Trace::Write(const char* path)
+    {
+        FILE* file = fopen(path, "w");
+        if (file == nullptr)
+        {
+            printf("Can't write the trace to %s\n", path);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(tracksMutex);
+        fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+        const char* separator = "";
+        unsigned long long dropped = 0;
+        for (auto& track : tracks)
+        {
+            std::lock_guard<std::mutex> trackLock(track->mutex);
+            dropped += track->added - track->events.size();
+
+            // Tracks sort in the order they appeared
+            fprintf(file, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", separator, track->id);
+            writeString(file, track->name.c_str());
+            fprintf(file, "}},\n{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%d}}", track->id, track->id);
+            separator = ",\n";
+
+            // Oldest first, where the ring wrapped
+            const size_t count = track->events.size();
+            const size_t first = (size_t)(track->added % (count > 0 ? count : 1));
+            for (size_t i = 0; i < count; i++)
+            {
+                const TraceEvent& event = track->events[(first + i) % count];
+                fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"name\":", track->id, event.beginUs, event.durationUs);
+                writeString(file, event.name);
+                fputc('}', file);
+            }
+        }
+        fprintf(file, "\n]}\n");
+
+        if (dropped > 0)
+        {
+            printf("The trace kept the last %zu events of each thread, %llu older ones were dropped\n", Trace::EVENTS_PER_TRACK, dropped);
+        }
+
+        const bool written = (ferror(file) == 0);
+        fclose(file);
+        return written;
+    }
+};
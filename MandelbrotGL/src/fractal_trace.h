@@ -0,0 +1,81 @@
+#ifndef FRACTAL_TRACE_H
+#define FRACTAL_TRACE_H
+
+#include <atomic>
+#include <string>
+#include <stddef.h>
+
+namespace fractal
+{
+    // Timeline of what each thread did, written as Chrome Trace Event JSON for Perfetto or
+    // chrome://tracing. Each thread gets a track, named by NameThread() or after its order of
+    // appearance, and tracks of no thread hold work timed elsewhere, as GPU timer results.
+    // Until Start(), a scope costs one relaxed atomic load. Event names must outlive the trace.
+    // Tracks keep their last EVENTS_PER_TRACK events, so long sessions hold the end of it in
+    // bounded memory: some 3 MB a track, where CPU tiles alone add thousands a second.
+
+    class Trace
+    {
+    public:
+
+        static constexpr size_t EVENTS_PER_TRACK = 1 << 17;
+
+        // Forgets what was recorded before
+        static void Start();
+        static void Stop() noexcept { enabled.store(false, std::memory_order_relaxed); }
+        static bool Enabled() noexcept { return enabled.load(std::memory_order_relaxed); }
+
+        // Microseconds since Start()
+        static double NowUs() noexcept;
+
+        static void NameThread(const std::string& name);
+        static int AddTrack(const std::string& name);
+
+        // On the calling thread's track, or on track
+        static void Complete(const char* name, double beginUs, double endUs);
+        static void Complete(int track, const char* name, double beginUs, double endUs);
+
+        // Events of every track so far
+        static bool Write(const char* path);
+
+    private:
+
+        static std::atomic<bool> enabled;
+    };
+
+    // Event from construction to destruction, on the calling thread's track
+
+    class TraceScope
+    {
+    public:
+
+        explicit TraceScope(const char* name) noexcept:
+            name(Trace::Enabled() ? name : nullptr), beginUs(this->name ? Trace::NowUs() : 0.0)
+        {
+        }
+
+        TraceScope(const TraceScope& rhs) = delete;
+        TraceScope& operator=(const TraceScope& rhs) = delete;
+
+        ~TraceScope()
+        {
+            if (name)
+            {
+                Trace::Complete(name, beginUs, Trace::NowUs());
+            }
+        }
+
+    private:
+
+        const char* name;
+        double beginUs;
+    };
+};
+
+#define FRACTAL_TRACE_JOIN2(a, b) a##b
+#define FRACTAL_TRACE_JOIN(a, b) FRACTAL_TRACE_JOIN2(a, b)
+
+// Traces the rest of the enclosing block
+#define FRACTAL_TRACE_SCOPE(name) fractal::TraceScope FRACTAL_TRACE_JOIN(traceScope, __LINE__)(name)
+
+#endif // FRACTAL_TRACE_H
@@ -74,6 +74,65 @@ namespace gl
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, purpose);
 		}
 
+    private:
+
+        GLuint id = 0;
+        GLenum purpose;
+	};
+
+	class ShaderStorageBuffer
+	{
+	public:
+
+		ShaderStorageBuffer(GLenum purpose = GL_DYNAMIC_DRAW):
+			purpose(purpose)
+		{
+			glGenBuffers(1, &id);
+		}
+
+		~ShaderStorageBuffer()
+		{
+			glDeleteBuffers(1, &id);
+		}
+
+		void Bind() const
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+		}
+
+		void Unbind() const
+		{
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		}
+
+		// Binding point of the "layout(std430, binding = ...)" block
+		void BindBase(unsigned int binding) const
+		{
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, id);
+		}
+
+		// Where ComputeShader::computeIndirect() reads its workgroup count
+		void BindIndirect() const
+		{
+			glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, id);
+		}
+
+		void update(unsigned int size, const void* data) const
+		{
+			glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, purpose);
+		}
+
+		void updateSub(unsigned int offset, unsigned int size, const void* data) const
+		{
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+		}
+
+		// Stalls until the GPU is done writing it
+		void read(unsigned int offset, unsigned int size, void* data) const
+		{
+			glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, offset, size, data);
+		}
+
     private:
 
         GLuint id = 0;
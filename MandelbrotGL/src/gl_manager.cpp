@@ -3,6 +3,15 @@
 
 #include <stdio.h>
 
+#if defined(__linux__)
+#define GL_MANAGER_EGL 1
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#else
+#define GL_MANAGER_EGL 0
+#endif
+
 namespace gl
 {
     // Manager ///////////////////////////////////////////////////////
@@ -10,48 +19,166 @@ namespace gl
     Manager Manager::instance;
 
 	Manager::Manager()
+	{
+	}
+
+	Manager::~Manager()
+	{
+		if (window)
+		{
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+
+#if GL_MANAGER_EGL
+		if (eglContext)
+		{
+			eglMakeCurrent((EGLDisplay)eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext((EGLDisplay)eglDisplay, (EGLContext)eglContext);
+			eglTerminate((EGLDisplay)eglDisplay);
+		}
+#endif
+	}
+
+    // System
+
+	bool Manager::Init(Backend backend)
+	{
+		if (instance.success)
+		{
+			return instance.backend == backend;
+		}
+
+		instance.backend = backend;
+		switch (backend)
+		{
+		case Backend::WINDOW:
+			instance.success = instance.initWindow(true) && ImguiManager::Init();
+			break;
+
+		case Backend::HEADLESS:
+			instance.success = instance.initHeadless();
+			break;
+		}
+
+		return instance.success;
+	}
+
+	bool Manager::initWindow(bool visible)
 	{
 		/* Initialize the library */
 		if (glfwInit() == false)
 		{
-			return;
+			return false;
 		}
 
 		/* Create a windowed mode window and its OpenGL context */
+		glfwWindowHint(GLFW_VISIBLE, visible ? GLFW_TRUE : GLFW_FALSE);
 		window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Mandelbrot", NULL, NULL);
 		if (window == nullptr)
 		{
 			glfwTerminate();
-			return;
+			return false;
 		}
 
 		/* Make the window's context current */
 		glfwMakeContextCurrent(window);
 
 		// Init glew after context is created
-		GLenum err = glewInit();
-		if (err != GLEW_OK)
+		if (initGlew() == false)
 		{
-			/* Problem: glewInit failed, something is seriously wrong. */
-			printf("Error: %s\n", glewGetErrorString(err));
-			return;
+			return false;
 		}
 
         glfwSetKeyCallback(window, &keyCallback);
+		return true;
+	}
 
-		printf("OpenGL version: %s\n", glGetString(GL_VERSION));
-		printf("GLEW version: %s\n", glewGetString(GLEW_VERSION));
+	bool Manager::initHeadless()
+	{
+#if GL_MANAGER_EGL
+		// Surfaceless Mesa platform first: needs neither X11 nor a DRM device, so llvmpipe works in containers
+		EGLDisplay display = EGL_NO_DISPLAY;
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+		{
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		}
+		if (display == EGL_NO_DISPLAY)
+		{
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		}
+
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || eglInitialize(display, &major, &minor) == EGL_FALSE)
+		{
+			printf("Error: no EGL display\n");
+			return false;
+		}
+		eglDisplay = display;
+
+		if (eglBindAPI(EGL_OPENGL_API) == EGL_FALSE)
+		{
+			printf("Error: EGL has no desktop OpenGL\n");
+			return false;
+		}
 
-		success = true;
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+		EGLConfig config = EGL_NO_CONFIG_KHR;   // Fine as well with EGL_KHR_no_config_context
+		EGLint configCount = 0;
+		eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+		// Compute shaders need 4.3
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		EGLContext context = eglCreateContext(display, (configCount > 0) ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT)
+		{
+			printf("Error: no OpenGL 4.3 context from EGL (0x%x)\n", eglGetError());
+			return false;
+		}
+		eglContext = context;
+
+		// Surfaceless: everything goes to textures, there is no default framebuffer
+		if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) == EGL_FALSE)
+		{
+			printf("Error: EGL context can't be made current without a surface (0x%x)\n", eglGetError());
+			return false;
+		}
+
+		printf("EGL version: %d.%d\n", major, minor);
+		return initGlew();
+#else
+		return initWindow(false);
+#endif
 	}
 
-	Manager::~Manager()
+	bool Manager::initGlew()
 	{
-		glfwDestroyWindow(window);
-		glfwTerminate();
-	}
+		glewExperimental = GL_TRUE;     // Core profile contexts don't list extensions the old way
+		GLenum err = glewInit();
 
-    // System
+		// GLEW built for GLX loads the GL functions first, then fails on its GLX ones without an X display
+		const bool noGlx = (backend == Backend::HEADLESS && err == GLEW_ERROR_NO_GLX_DISPLAY);
+		if (err != GLEW_OK && noGlx == false)
+		{
+			/* Problem: glewInit failed, something is seriously wrong. */
+			printf("Error: %s\n", glewGetErrorString(err));
+			return false;
+		}
+
+		printf("OpenGL version: %s\n", glGetString(GL_VERSION));
+		printf("GLEW version: %s\n", glewGetString(GLEW_VERSION));
+		return true;
+	}
 
 	void Manager::EnableBlend()
 	{
@@ -124,6 +251,10 @@ namespace gl
     ImguiManager ImguiManager::instance;
 
     ImguiManager::ImguiManager()
+    {
+    }
+
+    bool ImguiManager::Init()
     {
         ImGui::CreateContext();
         ImGui_ImplGlfw_InitForOpenGL(Manager::Window(), true);
@@ -131,11 +262,17 @@ namespace gl
 
         ImGui::StyleColorsDark();
 
-        success = true;
+        instance.success = true;
+        return true;
     }
 
     ImguiManager::~ImguiManager()
     {
+        if (success == false)
+        {
+            return;
+        }
+
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
@@ -14,9 +14,18 @@ namespace gl
 	{
 	public:
 
+        enum class Backend
+        {
+            WINDOW,     // GLFW window, with ImGui
+            HEADLESS    // No window system: EGL surfaceless context on Linux, hidden GLFW window elsewhere
+        };
+
         // System
 
+        // Creates the context once, before any other gl:: object. Window() stays nullptr when headless.
+        static bool Init(Backend backend = Backend::WINDOW);
 		static bool InitSuccess() noexcept { return instance.success; }
+        static Backend GetBackend() noexcept { return instance.backend; }
         static void EnableBlend();
 
         // Window
@@ -58,9 +67,16 @@ namespace gl
         Manager& operator=(const Manager& rhs) = delete;
         Manager& operator=(const Manager&& rhs) = delete;
 
+        bool initWindow(bool visible);
+        bool initHeadless();
+        bool initGlew();
+
         static Manager instance;
 
+        Backend backend = Backend::WINDOW;
         GLFWwindow* window = nullptr;
+        void* eglDisplay = nullptr;     // EGLDisplay and EGLContext, when headless on EGL
+        void* eglContext = nullptr;
         KeyType keyState = KEY_NONE;
         bool success = false;
 
@@ -73,6 +89,8 @@ namespace gl
 	{
 	public:
 
+        // Called by Manager::Init() for the window backend
+        static bool Init();
 		static bool InitSuccess() noexcept { return instance.success; }
 
 	private:
@@ -98,6 +98,7 @@ namespace gl
 		{
 			GLint linkResult;
 			glGetProgramiv(id,  GL_LINK_STATUS, &linkResult);
+			linked = (linkResult != GL_FALSE);
 
 			if (linkResult == GL_FALSE)
 			{
@@ -148,6 +149,11 @@ namespace gl
 	{
 		glDispatchCompute(workgroupCount.x, workgroupCount.y, workgroupCount.z);
 	}
+
+	void ComputeShader::computeIndirect(GLintptr offset) const
+	{
+		glDispatchComputeIndirect(offset);
+	}
 };
 
 //void gpuTest()
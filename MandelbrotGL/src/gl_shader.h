@@ -13,6 +13,7 @@ namespace gl
 	public:
 		virtual ~Shader();
 		void Validate();    // Validation should happen after uniforms are set, right before using
+		bool Linked() const noexcept { return linked; }
 
 		void Bind() const
 		{
@@ -44,6 +45,23 @@ namespace gl
 			glUniform4f(getUniformLocation(name), v0, v1, v2, v3);
 		}
 
+		// Double uniforms need GL 4.0 or GL_ARB_gpu_shader_fp64
+
+		void SetUniform1d(const char* name, double v0)
+		{
+			glUniform1d(getUniformLocation(name), v0);
+		}
+
+		void SetUniform2d(const char* name, double v0, double v1)
+		{
+			glUniform2d(getUniformLocation(name), v0, v1);
+		}
+
+		void SetUniform4d(const char* name, double v0, double v1, double v2, double v3)
+		{
+			glUniform4d(getUniformLocation(name), v0, v1, v2, v3);
+		}
+
 		void SetUniformMat4f(const char* name, const glm::mat4& a_matrix)
 		{
 			glUniformMatrix4fv(getUniformLocation(name), 1/*num of mat*/, GL_FALSE, &a_matrix[0][0]);
@@ -58,6 +76,7 @@ namespace gl
 
     protected:
         GLuint id = 0;
+        bool linked = false;
         std::unordered_map<const char*, GLint> mUniformLocations;
 	};
 
@@ -72,6 +91,9 @@ namespace gl
 	public:
 		ComputeShader(const char* computeShaderpath);
 		void compute(glm::ivec3 workgroupCount) const;
+
+		// Workgroup count as 3 uints at offset in the buffer bound to GL_DISPATCH_INDIRECT_BUFFER
+		void computeIndirect(GLintptr offset) const;
 	};
 };
 
@@ -21,10 +21,12 @@ namespace gl
             {
             case PixelFormat::R8:
             case PixelFormat::R32F: return GL_RED;
-            case PixelFormat::R8UI: return GL_RED_INTEGER;
+            case PixelFormat::R8UI:
+            case PixelFormat::R32UI: return GL_RED_INTEGER;
             case PixelFormat::RGB8: return GL_RGB;
             case PixelFormat::RGBA8:
             case PixelFormat::RGBA32F: return GL_RGBA;
+            case PixelFormat::RGBA32UI: return GL_RGBA_INTEGER;
             }
         }();
 
@@ -35,6 +37,8 @@ namespace gl
             case PixelFormat::R8: return GL_R8;
             case PixelFormat::R32F: return GL_R32F;
             case PixelFormat::R8UI: return GL_R8UI;
+            case PixelFormat::R32UI: return GL_R32UI;
+            case PixelFormat::RGBA32UI: return GL_RGBA32UI;
             case PixelFormat::RGB8: return GL_RGB8;
             case PixelFormat::RGBA8: return GL_RGBA8;
             case PixelFormat::RGBA32F: return GL_RGBA32F;
@@ -51,6 +55,8 @@ namespace gl
             case PixelFormat::RGBA8: return GL_UNSIGNED_BYTE;
             case PixelFormat::R32F:
             case PixelFormat::RGBA32F: return GL_FLOAT;
+            case PixelFormat::R32UI:
+            case PixelFormat::RGBA32UI: return GL_UNSIGNED_INT;
             }
         }();
 
@@ -69,8 +75,10 @@ namespace gl
         glGenTextures(1, &id);
         glBindTexture(target, id);
 
-        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        // Integer textures can't be filtered, and read as incomplete with GL_LINEAR
+        const bool isInteger = (this->pixelFormat == GL_RED_INTEGER || this->pixelFormat == GL_RGBA_INTEGER);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, isInteger ? GL_NEAREST : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, isInteger ? GL_NEAREST : GL_LINEAR);
         glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);   // (s, t) means (x, y)
         switch (textureTarget)
         {
@@ -106,8 +114,40 @@ namespace gl
         glTexImage1D(GL_TEXTURE_1D, 0, internalPixelFormat, dataWidth, 0, pixelFormat, pixelType, pixelData);
     }
 
-    void Texture::BindToImageUnit(unsigned int slot)
+    void Texture::UpdateSubPixelData(glm::ivec2 offset, glm::ivec2 dimension, const void* pixelData, int rowLength)
+    {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, rowLength);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, offset.x, offset.y, dimension.x, dimension.y, pixelFormat, pixelType, pixelData);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    void Texture::ReadPixelData(void* pixelData)
     {
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, pixelFormat, pixelType, pixelData);
+    }
+
+    void Texture::CopySubImage(const Texture& source, glm::ivec2 sourceOffset, glm::ivec2 offset, glm::ivec2 dimension)
+    {
+        glCopyImageSubData(
+            source.id, source.target, 0, sourceOffset.x, sourceOffset.y, 0,
+            id, target, 0, offset.x, offset.y, 0,
+            dimension.x, dimension.y, 1
+        );
+    }
+
+    void Texture::BindToImageUnit(unsigned int slot, ImageAccess access)
+    {
+        const GLenum glAccess = [access]()
+        {
+            switch (access)
+            {
+            case ImageAccess::READ: return GL_READ_ONLY;
+            case ImageAccess::WRITE: return GL_WRITE_ONLY;
+            case ImageAccess::READ_WRITE: return GL_READ_WRITE;
+            }
+        }();
+
         switch (internalPixelFormat)
         {
         case GL_RGB8:
@@ -117,7 +157,7 @@ namespace gl
 
         // Might be dangerous
         default:
-            glBindImageTexture(slot, id, 0, GL_FALSE, 0, GL_WRITE_ONLY, internalPixelFormat);
+            glBindImageTexture(slot, id, 0, GL_FALSE, 0, glAccess, internalPixelFormat);
             break;
         }
     }
@@ -13,7 +13,12 @@ namespace gl
 
 	enum class PixelFormat
 	{
-		RGB8, RGBA8, RGBA32F, R8, R32F, R8UI
+		RGB8, RGBA8, RGBA32F, R8, R32F, R8UI, R32UI, RGBA32UI
+	};
+
+	enum class ImageAccess
+	{
+		READ, WRITE, READ_WRITE
 	};
 
 	enum class TextureWrap
@@ -39,7 +44,14 @@ namespace gl
 
 		void UpdatePixelData(glm::ivec2 dataDimension, const void* pixelData);  // 2D overload
 		void UpdatePixelData(int dataDimension, const void* pixelData);         // 1D overload
-		void BindToImageUnit(unsigned int slot = 0);
+
+		// 2D, part of level 0; rowLength is the pixels between rows of pixelData, 0 for dimension.x
+		void UpdateSubPixelData(glm::ivec2 offset, glm::ivec2 dimension, const void* pixelData, int rowLength = 0);
+		void ReadPixelData(void* pixelData);    // 2D, whole level 0 in the texture's own format
+		void BindToImageUnit(unsigned int slot = 0, ImageAccess access = ImageAccess::WRITE);
+
+		// 2D only, formats must be compatible. Source and destination regions may not overlap.
+		void CopySubImage(const Texture& source, glm::ivec2 sourceOffset, glm::ivec2 offset, glm::ivec2 dimension);
 
 		//constexpr int getPixelDataStride();
 
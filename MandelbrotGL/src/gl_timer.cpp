@@ -0,0 +1,117 @@
+#include "gl_timer.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace gl
+{
+	GpuTimer::GpuTimer(int depth):
+		queries(2 * depth), tags(depth), depth(depth)
+	{
+		glGenQueries(2 * depth, queries.data());
+	}
+
+	GpuTimer::~GpuTimer()
+	{
+		glDeleteQueries(2 * depth, queries.data());
+	}
+
+	bool GpuTimer::Begin(unsigned long long tag)
+	{
+		if (pending == depth)
+		{
+			return false;
+		}
+
+		glQueryCounter(queries[2 * next], GL_TIMESTAMP);
+		tags[next] = tag;
+		timing = true;
+		return true;
+	}
+
+	void GpuTimer::End()
+	{
+		if (timing)
+		{
+			glQueryCounter(queries[2 * next + 1], GL_TIMESTAMP);
+			next = (next + 1) % depth;
+			pending++;
+			timing = false;
+		}
+	}
+
+	bool GpuTimer::Read(GpuInterval& interval)
+	{
+		if (pending == 0)
+		{
+			return false;
+		}
+
+		// The end is written after the begin
+		const int oldest = (next - pending + depth) % depth;
+		GLint available = GL_FALSE;
+		glGetQueryObjectiv(queries[2 * oldest + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == GL_FALSE)
+		{
+			return false;
+		}
+
+		glGetQueryObjectui64v(queries[2 * oldest], GL_QUERY_RESULT, &interval.begin);
+		glGetQueryObjectui64v(queries[2 * oldest + 1], GL_QUERY_RESULT, &interval.end);
+		interval.tag = tags[oldest];
+		pending--;
+		return true;
+	}
+
+	bool GpuTimer::Read(double& ms)
+	{
+		GpuInterval interval;
+		if (Read(interval) == false)
+		{
+			return false;
+		}
+
+		ms = interval.Ms();
+		return true;
+	}
+
+	TimerStats::TimerStats(int size):
+		values(size)
+	{
+	}
+
+	void TimerStats::Add(double ms)
+	{
+		values[next] = (float)ms;
+		next = (next + 1) % (int)values.size();
+		count = std::min(count + 1, (int)values.size());
+	}
+
+	double TimerStats::Min() const noexcept
+	{
+		return (count > 0) ? *std::min_element(values.begin(), values.begin() + count) : 0.0;
+	}
+
+	double TimerStats::Average() const noexcept
+	{
+		double sum = 0.0;
+		for (int i = 0; i < count; i++)
+		{
+			sum += values[i];
+		}
+		return (count > 0) ? sum / count : 0.0;
+	}
+
+	double TimerStats::Percentile(double p) const
+	{
+		if (count == 0)
+		{
+			return 0.0;
+		}
+
+		std::vector<float> sorted(values.begin(), values.begin() + count);
+		const int rank = std::max((int)ceil(p * count) - 1, 0);
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+		return sorted[rank];
+	}
+};
@@ -0,0 +1,80 @@
+#ifndef GL_TIMER_H
+#define GL_TIMER_H
+
+#include "GL/glew.h"
+
+#include <vector>
+
+namespace gl
+{
+	// A timed interval, in GL_TIMESTAMP nanoseconds
+
+	struct GpuInterval
+	{
+		GLuint64 begin;
+		GLuint64 end;
+		unsigned long long tag;     // Given to GpuTimer::Begin(), the frame for instance
+
+		double Ms() const noexcept { return (double)(end - begin) / 1e6; }
+	};
+
+	// GPU time from Begin() to End(), between two GL_TIMESTAMP queries: they let timers overlap, and
+	// count compute dispatches where GL_TIME_ELAPSED doesn't (Mesa llvmpipe). Results arrive frames
+	// later, query pairs in flight taking turns in a ring so that nothing waits on the GPU: while
+	// all of them are in flight, intervals go untimed.
+
+	class GpuTimer
+	{
+	public:
+
+		explicit GpuTimer(int depth = 4);
+		GpuTimer(const GpuTimer& rhs) = delete;
+		~GpuTimer();
+		GpuTimer& operator=(const GpuTimer& rhs) = delete;
+
+		// False when the interval goes untimed
+		bool Begin(unsigned long long tag = 0);
+		void End();
+
+		// Oldest timed interval the GPU finished, in order of Begin(), false if none is done yet
+		bool Read(GpuInterval& interval);
+		bool Read(double& ms);
+
+	private:
+
+		std::vector<GLuint> queries;    // Begin and end of each interval
+		std::vector<unsigned long long> tags;
+		int depth;
+		int next = 0;       // Interval the next Begin() takes
+		int pending = 0;    // Intervals before next still in flight, or done but not read
+		bool timing = false;
+	};
+
+	// The last results of a timer, for display
+
+	class TimerStats
+	{
+	public:
+
+		explicit TimerStats(int size = 240);
+
+		void Add(double ms);
+
+		int Count() const noexcept { return count; }
+		double Min() const noexcept;
+		double Average() const noexcept;
+		double Percentile(double p) const;  // p in [0, 1], nearest rank
+
+		// Count() values from Offset() on, wrapping around, as ImGui::PlotLines() takes them
+		const float* Values() const noexcept { return values.data(); }
+		int Offset() const noexcept { return (count == (int)values.size()) ? next : 0; }
+
+	private:
+
+		std::vector<float> values;
+		int count = 0;
+		int next = 0;
+	};
+};
+
+#endif // GL_TIMER_H
@@ -3,26 +3,38 @@
 #include "gl_buffers.h"
 #include "gl_shader.h"
 #include "gl_texture.h"
+#include "gl_timer.h"
 
 #include "gl_constants.h"
 
+#include "fractal_boundary_engine.h"
+#include "fractal_cpu_engine.h"
+#include "fractal_escape_stats.h"
+#include "fractal_gpu_engine.h"
+#include "fractal_gpu_escape_stats.h"
+#include "fractal_gpu_perturbation_engine.h"
+#include "fractal_palette.h"
+#include "fractal_rect.h"
+#include "fractal_perturbation_engine.h"
+#include "fractal_resolution.h"
+#include "fractal_tile_cache.h"
+#include "fractal_trace.h"
+
 #include "glm.hpp"
 #include "gtc/matrix_transform.hpp"
 
-// Utility ///////////////////////////////////////////////////////
-
-// Rect type
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
 
-template<typename T>
-struct Rect {
-    T x, y, w, h;
-};
-typedef Rect<int> Recti;
-typedef Rect<float> Rectf;
+// Utility ///////////////////////////////////////////////////////
 
 // Function for filling vertex buffers
 
-void verteciesSrcRect(float vertecies[16], glm::ivec2 textureDim, Rectf srcRect)
+void verteciesSrcRect(float vertecies[16], glm::ivec2 textureDim, fractal::Rectf srcRect)
 {
 	vertecies[2] = vertecies[14] = srcRect.x / textureDim.x;
 	vertecies[6] = vertecies[10] = (srcRect.x + srcRect.w) / textureDim.x;
@@ -30,7 +42,7 @@ void verteciesSrcRect(float vertecies[16], glm::ivec2 textureDim, Rectf srcRect)
 	vertecies[11] = vertecies[15] = (srcRect.y + srcRect.h) / textureDim.y;
 }
 
-void verteciesDstRect(float vertecies[16], Rectf dstRect)
+void verteciesDstRect(float vertecies[16], fractal::Rectf dstRect)
 {
 	vertecies[0] = vertecies[12] = dstRect.x;
 	vertecies[4] = vertecies[8] = dstRect.x + dstRect.w;
@@ -38,17 +50,300 @@ void verteciesDstRect(float vertecies[16], Rectf dstRect)
 	vertecies[9] = vertecies[13] = dstRect.y + dstRect.h;
 }
 
+// Parts of a frame timed on the GPU, as the columns of --timings
+
+enum Phase { PHASE_COMPUTE, PHASE_DRAW, PHASE_IMGUI, PHASE_COUNT };
+const char* const PHASE_NAMES[PHASE_COUNT] = { "compute", "draw", "imgui" };
+
+// Starting view and shaders, shared by both modes
+
+fractal::View startView()
+{
+	return { fractal::Fixed::FromString("-0.25", 2), fractal::Fixed(2), 4.0 };
+}
+
+const fractal::GpuEngine::ShaderPaths gpuShaderPaths = {
+	"res/mandelbrot_cs.glsl", "res/mandelbrot_df_cs.glsl", "res/mandelbrot_fp64_cs.glsl", "res/mandelbrot_subdivide_cs.glsl"
+};
+
+// Tile cache: whole tiles seen before are uploaded, the rest is computed by the CPU or GPU
+// engine and kept. The frame has to be on the cache grid.
+
+void computeCached(const fractal::Frame& frame, fractal::TileCache& cache, bool useCpuEngine,
+	fractal::CpuEngine& cpuEngine, fractal::GpuEngine& gpuEngine, gl::Texture& tx, unsigned int txSlot, std::vector<uint32_t>& readback)
+{
+	const fractal::Precision precision = useCpuEngine ? cpuEngine.GetPrecision() : gpuEngine.PrecisionFor(frame);
+	const fractal::TileEngine engine = useCpuEngine ? fractal::CpuTileEngine(cpuEngine.GetIsa()) : fractal::TileEngine::GPU;
+	const uint32_t mode = ((useCpuEngine && cpuEngine.GetSubdivision()) ? fractal::TILE_SUBDIVISION : 0u) |
+		((useCpuEngine ? cpuEngine.GetInteriorChecks() : gpuEngine.GetInteriorChecks()) ? fractal::TILE_INTERIOR_CHECKS : 0u);
+	std::vector<fractal::TileCache::Placement> misses;
+	std::vector<fractal::Tile> regions;
+
+	tx.Bind(txSlot);
+	for (const auto& placement : fractal::TileCache::Layout(frame, engine, precision, mode))
+	{
+		const fractal::Recti& rect = placement.rect;
+		const uint32_t* pixels = placement.whole ? cache.Find(placement.key) : nullptr;
+		if (pixels)
+		{
+			tx.UpdateSubPixelData({ rect.x, rect.y }, { rect.w, rect.h }, pixels);
+			continue;
+		}
+		misses.push_back(placement);
+		regions.push_back({ rect.x, rect.y, rect.w, rect.h });
+	}
+
+	if (regions.empty())
+	{
+		return;
+	}
+
+	// Computed pixels, laid out like the texture
+	const uint32_t* computed = nullptr;
+	if (useCpuEngine)
+	{
+		cpuEngine.Compute(frame, regions);
+		computed = cpuEngine.Pixels().data();
+		tx.Bind(txSlot);
+		for (const fractal::Tile& region : regions)
+		{
+			tx.UpdateSubPixelData({ region.x, region.y }, { region.w, region.h },
+				computed + (size_t)region.y * frame.imageDim.x + region.x, frame.imageDim.x);
+		}
+	}
+	else
+	{
+		gpuEngine.Compute(frame, regions);
+		readback.resize((size_t)frame.imageDim.x * frame.imageDim.y);
+		tx.Bind(txSlot);
+		tx.ReadPixelData(readback.data());
+		computed = readback.data();
+	}
+
+	for (const auto& placement : misses)
+	{
+		if (placement.whole)
+		{
+			cache.Insert(placement.key, computed + (size_t)placement.rect.y * frame.imageDim.x + placement.rect.x, frame.imageDim.x);
+		}
+	}
+}
+
+// Headless: computes the starting view once on the GPU engine and reads it back,
+// to check the GPU path on machines without a display
+
+int runHeadless(bool interiorChecks)
+{
+	const unsigned int txSlot = 0;
+	const unsigned int imageSlot = 2;
+
+	gl::Texture tx(gl::TextureTarget::TEX2D, gl::PixelFormat::R32UI, gl::TextureWrap::WRAP);
+	tx.Bind(txSlot);
+	tx.UpdatePixelData(gl::TEXTURE_DIM, nullptr);
+	tx.BindToImageUnit(imageSlot, gl::ImageAccess::READ_WRITE);
+
+	fractal::GpuEngine gpuEngine(gpuShaderPaths, imageSlot);
+	gpuEngine.SetInteriorChecks(interiorChecks);
+	fractal::Frame frame = fractal::MakeFrame(startView(), gl::TEXTURE_DIM, 256);
+
+	auto start = std::chrono::steady_clock::now();
+	{
+		FRACTAL_TRACE_SCOPE("compute");
+		gpuEngine.Compute(frame);
+	}
+
+	std::vector<uint32_t> pixels((size_t)frame.imageDim.x * frame.imageDim.y);
+	{
+		FRACTAL_TRACE_SCOPE("readback");
+		tx.Bind(txSlot);
+		tx.ReadPixelData(pixels.data());
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	// Enough to compare runs: pixels left inside, and an FNV-1a hash of all of them
+	size_t inside = 0;
+	uint32_t hash = 2166136261u;
+	for (uint32_t it : pixels)
+	{
+		inside += (it == 0);
+		hash = (hash ^ it) * 16777619u;
+	}
+
+	printf("Headless %s%s: %dx%d, %d iterations, %.2f ms\n", fractal::GpuEngine::PrecisionName(gpuEngine.LastPrecision()),
+		(interiorChecks) ? " with interior checks" : "",
+		frame.imageDim.x, frame.imageDim.y, frame.iteration, std::chrono::duration<double, std::milli>(end - start).count());
+	printf("%zu pixels inside, hash %08x\n", inside, hash);
+
+	return (glGetError() == GL_NO_ERROR) ? 0 : -1;
+}
+
+// Headless benchmark of interior checks: views mostly inside the set, where iterating to the cap
+// costs the most, computed with the checks off then on by the CPU and GPU engines. Times are the
+// best of a few runs, the GPU's readback included; pixels that differ are the periodicity check
+// ending orbits that would have escaped past its tolerance.
+
+struct BenchmarkView
+{
+	const char* name;
+	const char* centerX;
+	const char* centerY;
+	double range;
+};
+
+const BenchmarkView BENCHMARK_VIEWS[] = {
+	{ "cardioid", "-0.1", "0.1", 0.3 },         // All inside the main cardioid
+	{ "whole", "-0.25", "0", 4.0 },
+	{ "bulbs", "-1.25", "0", 0.5 },             // Period 2 bulb and its children
+	{ "minibrot", "-0.16", "1.0405", 0.02 },
+	{ "seahorse", "-0.7436447860", "0.1318252536", 1e-3 }
+};
+const glm::ivec2 BENCHMARK_DIM = { 512, 512 };
+const int BENCHMARK_ITERATION = 2048;
+const int BENCHMARK_RUNS = 3;
+
+int runBenchmark()
+{
+	const unsigned int txSlot = 0;
+	const unsigned int imageSlot = 2;
+
+	gl::Texture tx(gl::TextureTarget::TEX2D, gl::PixelFormat::R32UI, gl::TextureWrap::WRAP);
+	tx.Bind(txSlot);
+	tx.UpdatePixelData(gl::TEXTURE_DIM, nullptr);
+	tx.BindToImageUnit(imageSlot, gl::ImageAccess::READ_WRITE);
+
+	fractal::GpuEngine gpuEngine(gpuShaderPaths, imageSlot);
+	fractal::CpuEngine cpuEngine;
+	const glm::ivec2 textureDim = gl::TEXTURE_DIM;
+	std::vector<uint32_t> readback((size_t)textureDim.x * textureDim.y);
+
+	// Best time of the runs, and the pixels of the last
+	auto time = [&](bool gpu, bool interiorChecks, const fractal::Frame& frame, std::vector<uint32_t>& pixels)
+	{
+		double bestMs = 0.0;
+		for (int run = 0; run < BENCHMARK_RUNS; run++)
+		{
+			FRACTAL_TRACE_SCOPE(gpu ? "GPU run" : "CPU run");
+			auto start = std::chrono::steady_clock::now();
+			if (gpu)
+			{
+				gpuEngine.SetInteriorChecks(interiorChecks);
+				gpuEngine.InvalidateImage();
+				gpuEngine.Compute(frame);
+				tx.Bind(txSlot);
+				tx.ReadPixelData(readback.data());
+			}
+			else
+			{
+				cpuEngine.SetInteriorChecks(interiorChecks);
+				cpuEngine.Compute(frame);
+			}
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			bestMs = (run == 0) ? ms : std::min(bestMs, ms);
+		}
+
+		// The texture is wider than the frame, rows keep its pitch
+		pixels.resize((size_t)frame.imageDim.x * frame.imageDim.y);
+		for (int y = 0; y < frame.imageDim.y; y++)
+		{
+			const uint32_t* row = gpu ? readback.data() + (size_t)y * textureDim.x : cpuEngine.Pixels().data() + (size_t)y * frame.imageDim.x;
+			std::copy(row, row + frame.imageDim.x, pixels.begin() + (size_t)y * frame.imageDim.x);
+		}
+		return bestMs;
+	};
+
+	printf("Interior checks, %dx%d, %d iterations, best of %d runs\n", BENCHMARK_DIM.x, BENCHMARK_DIM.y, BENCHMARK_ITERATION, BENCHMARK_RUNS);
+	printf("%-10s %-4s %7s %12s %12s %8s %14s\n", "view", "", "inside", "off (ms)", "on (ms)", "speedup", "pixels differ");
+
+	std::vector<uint32_t> off, on;
+	for (const BenchmarkView& benchmarkView : BENCHMARK_VIEWS)
+	{
+		const fractal::View view = {
+			fractal::Fixed::FromString(benchmarkView.centerX, 2), fractal::Fixed::FromString(benchmarkView.centerY, 2), benchmarkView.range
+		};
+		const fractal::Frame frame = fractal::MakeFrame(view, BENCHMARK_DIM, BENCHMARK_ITERATION);
+
+		for (bool gpu : { false, true })
+		{
+			const double offMs = time(gpu, false, frame, off);
+			const double onMs = time(gpu, true, frame, on);
+
+			size_t inside = 0, differ = 0;
+			for (size_t i = 0; i < off.size(); i++)
+			{
+				inside += (off[i] == 0);
+				differ += (off[i] != on[i]);
+			}
+			printf("%-10s %-4s %6.1f%% %12.2f %12.2f %7.1fx %14zu\n", benchmarkView.name, gpu ? "GPU" : "CPU",
+				100.0 * inside / off.size(), offMs, onMs, offMs / onMs, differ);
+		}
+	}
+
+	return (glGetError() == GL_NO_ERROR) ? 0 : -1;
+}
+
 // Program ///////////////////////////////////////////////////////
 
-int main()
+int main(int argc, char* argv[])
 {
 	// Set up OpenGL
 
-	if (gl::Manager::InitSuccess() == false)
+	bool headless = false;
+	bool headlessInteriorChecks = false;
+	bool benchmark = false;
+	const char* tileCacheFile = nullptr;          // Where the tile cache spills, kept across sessions
+	const char* timingsFile = nullptr;            // CSV of the GPU time of each phase of each frame
+	const char* traceFile = nullptr;              // Chrome Trace Event JSON of the session, for Perfetto
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			headless = true;
+		}
+		else if (strcmp(argv[i], "--interior-checks") == 0)
+		{
+			headlessInteriorChecks = true;
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			headless = true;
+			benchmark = true;
+		}
+		else if (strcmp(argv[i], "--tile-cache") == 0 && i + 1 < argc)
+		{
+			tileCacheFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--timings") == 0 && i + 1 < argc)
+		{
+			timingsFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			traceFile = argv[++i];
+		}
+	}
+
+	if (gl::Manager::Init(headless ? gl::Manager::Backend::HEADLESS : gl::Manager::Backend::WINDOW) == false)
 	{
 		return -1;
 	}
 
+	if (traceFile)
+	{
+		fractal::Trace::Start();
+		fractal::Trace::NameThread("Main");
+	}
+
+	if (headless)
+	{
+		const int result = benchmark ? runBenchmark() : runHeadless(headlessInteriorChecks);
+		if (traceFile)
+		{
+			fractal::Trace::Stop();
+			fractal::Trace::Write(traceFile);
+		}
+		return result;
+	}
+
 	glfwSwapInterval(1);
 
 	// Graphics
@@ -88,103 +383,301 @@ int main()
         const unsigned int txSlot = 0;
         const unsigned int txColorSlot = 1;
         const unsigned int imageSlot = 2;
+        const unsigned int glitchMaskSlot = 3;
+        const unsigned int resumeStateSlot = 4;
+        const unsigned int txSmoothSlot = 4;
+        const unsigned int smoothImageSlot = 5;
 
-		gl::Texture tx(gl::TextureTarget::TEX2D, gl::PixelFormat::R8, gl::TextureWrap::WRAP);
+		// Escape iterations, which the fragment shader colors within the current iteration
+		gl::Texture tx(gl::TextureTarget::TEX2D, gl::PixelFormat::R32UI, gl::TextureWrap::WRAP);
 		tx.Bind(txSlot);
 		tx.UpdatePixelData(gl::TEXTURE_DIM, nullptr);
-		tx.BindToImageUnit(imageSlot);
+		tx.BindToImageUnit(imageSlot, gl::ImageAccess::READ_WRITE);
+
+		gl::Texture txSmooth(gl::TextureTarget::TEX2D, gl::PixelFormat::R32F, gl::TextureWrap::WRAP);
+		txSmooth.Bind(txSmoothSlot);
+		txSmooth.UpdatePixelData(gl::TEXTURE_DIM, nullptr);
+		txSmooth.BindToImageUnit(smoothImageSlot);
 
 		gl::Texture txDrawColor(gl::TextureTarget::TEX1D, gl::PixelFormat::RGB8, gl::TextureWrap::CHOP);
 		txDrawColor.Bind(txColorSlot);
-        const uint8_t colorData[] = {
-              0,   0,   0,
-            230, 200,   0,
-            240, 160,   0,
-            250, 100,   0,
-            255,  50,  10,
-            230,   0,  50,
-            150,   0, 130,
-            100,   0, 190,
-             20,   0, 220,
-              0,  50, 230,
-              0, 100, 200,
-              0, 150, 140,
-              0, 160, 120,
-              0, 170, 100,
-              0, 180,  80,
-             10, 190,  50,
-             20, 200,  15,
-             30, 210,   0,
-            255, 220,   0,
-            255, 220,   0,
-            255, 220,   0,
-            255, 220,   0,
-            255, 220,   0,
-            255, 220,   0,
-            255, 220,   0,
-            255, 220,   0
-        };
-		txDrawColor.UpdatePixelData((sizeof(colorData) / sizeof(uint8_t)) / 3, colorData);
+		txDrawColor.UpdatePixelData(fractal::PALETTE_SIZE, fractal::PALETTE);
 
 		// Shaders
 
-		gl::GraphicShader graphicShader("res\\basic_texture_vs.glsl", "res\\basic_texture_fs.glsl");
+		gl::GraphicShader graphicShader("res/basic_texture_vs.glsl", "res/basic_texture_fs.glsl");
 		graphicShader.Bind();
 		graphicShader.SetUniform1i("uPositionTexture", txSlot);
 		graphicShader.SetUniform1i("uColorTexture", txColorSlot);
+		graphicShader.SetUniform1i("uSmoothTexture", txSmoothSlot);
 		graphicShader.SetUniformMat4f( "uMVP",
 			glm::ortho(0.0f, (float)gl::WINDOW_WIDTH, 0.0f, (float)gl::WINDOW_HEIGHT, -1.0f, 1.0f)
 		);
 
-		gl::ComputeShader computeShader("res\\mandelbrot_cs.glsl");
-		computeShader.Bind();
-		computeShader.SetUniform1i("uImage", imageSlot);
-        computeShader.SetUniform2f("uImageDim", gl::TEXTURE_DIM.x, gl::TEXTURE_DIM.y);
+		// Engines
+
+		fractal::GpuEngine gpuEngine(gpuShaderPaths, imageSlot);
+		gpuEngine.SetReprojectionImage(&tx);
+		gpuEngine.EnableIterationResume(resumeStateSlot);
+		gpuEngine.SetSmoothImage(&txSmooth, smoothImageSlot);
+		gpuEngine.SetInteriorChecks(true);
+		gpuEngine.SetProgressive(true, 12.0);
+		fractal::CpuEngine cpuEngine;
+		cpuEngine.SetInteriorChecks(true);
+		fractal::BoundaryTraceEngine traceEngine;
+		traceEngine.SetInteriorChecks(true);
+		fractal::GpuPerturbationEngine gpuPerturbationEngine("res/mandelbrot_perturbation_cs.glsl", imageSlot, glitchMaskSlot);
+		fractal::PerturbationEngine perturbationEngine;
+		fractal::GpuEscapeStats gpuEscapeStats("res/escape_stats_cs.glsl", imageSlot);
+
+		// Scaled frames fill the corner of the textures, which keep their full size, and the quad's
+		// texture coordinates stretch that corner over the window
+		fractal::DynamicResolution resolution(gl::TEXTURE_DIM);
+
+		// GPU time of the compute shaders, the fractal's quad and ImGui, each frame
+		gl::GpuTimer phaseTimers[PHASE_COUNT];
+		gl::TimerStats phaseStats[PHASE_COUNT];
+		unsigned long long frameIndex = 0;
+		FILE* timings = nullptr;
+		if (timingsFile)
+		{
+			timings = fopen(timingsFile, "w");
+			if (timings) fprintf(timings, "frame,phase,gpu_ms\n");
+			else printf("Can't write timings to %s\n", timingsFile);
+		}
+
+		// The same results in the trace, GL_TIMESTAMP nanoseconds counted from when both clocks were read
+		const int gpuTrack = (traceFile) ? fractal::Trace::AddTrack("GPU") : 0;
+		GLint64 gpuOriginNs = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuOriginNs);
+		const double gpuOriginUs = fractal::Trace::NowUs();
+
+		fractal::TileCache tileCache;
+		if (tileCacheFile)
+		{
+			tileCache.SetSpillFile(tileCacheFile);
+		}
+		std::vector<uint32_t> tileReadback;
 
 		// Variables controlled by Imgui
 
-		glm::vec2 numberCenter = { -0.25f, 0.0f };
+		fractal::View view = startView();
 		glm::vec2 c = { 0.0f, 0.0f };
-		float rangeX = 4.0f;
 		int iteration = 256;
+		int computedIteration = 0;  // Of what tx holds, lower iterations only need coloring
+		glm::dvec2 panPixels = { 0.0, 0.0 };    // Not yet applied to view, which only moves by whole pixels
 
         constexpr float rangeAddZoomPerSec = 1.0f;  // relative to rangeX
         constexpr float rangeMovePerSec = 0.25f;    // relative to rangeX
+        const double rangeMin =     // Where the finest precision goes blocky
+            gpuEngine.SupportsDouble() ? 1e-11 :
+            gpuEngine.SupportsDoubleFloat() ? 1e-9 : 0.00005;
+        constexpr double perturbationRangeMin = 1e-290; // Pixel deltas still well above the double minimum
 
         bool shiftLeftPressed = false;
         bool shiftRightPressed = false;
+        bool shiftUpPressed = false;
+        bool shiftDownPressed = false;
 		
 		// Run
 
 		bool needDraw = true;
 		bool lazyDraw = true;
-
-		computeShader.Validate();
+		bool useCpuEngine = false;
+		bool usePerturbation = false;
+		bool useSeriesApproximation = true;
+		bool reusePannedPixels = true;
+		bool resumeIterations = true;
+		bool smoothColoring = true;
+		bool smoothComputed = false;
+		bool useTileCache = false;
+		bool useSubdivision = false;
+		bool useBoundaryTrace = false;
+		bool useInteriorChecks = true;
+		bool progressiveRefinement = true;
+		float refineBudgetMs = 12.0f;     // Of compute per frame, finer passes wait for the next ones
+		bool autoIteration = false;
+		fractal::IterationBounds iterationBounds = { 128, 1 << 16, 0.001 };
+		fractal::EscapeStats escapeStats = {};
+		bool escapeStatsPending = false;   // Of a GPU frame, taken once it's refined to the last pass
+		bool dynamicResolution = false;
+		float targetFrameMs = 16.6f;    // Of compute per frame while the view moves
+		bool viewMoving = false;        // Set by the keys, until the next frame is computed
+		glm::ivec2 computedDim = gl::TEXTURE_DIM;   // Of what tx holds
+
+		gpuEngine.Validate();
+		gpuPerturbationEngine.Validate();
+		gpuEscapeStats.Validate();
 		graphicShader.Validate();
 		
 		while (gl::Manager::WindowShouldClose() == false)
 		{
 			// Compute
 
+			// The cache grid only has power of two zooms, which shift+up/down then step through
+			const bool tileCacheActive = useTileCache && usePerturbation == false;
+			if (tileCacheActive)
+			{
+				view = fractal::TileCache::Align(view, gl::TEXTURE_DIM);
+			}
+
+			// Results of frames before, in the order they were timed
+			for (int phase = 0; phase < PHASE_COUNT; phase++)
+			{
+				gl::GpuInterval interval;
+				while (phaseTimers[phase].Read(interval))
+				{
+					phaseStats[phase].Add(interval.Ms());
+					if (phase == PHASE_COMPUTE)
+					{
+						resolution.Measured(interval.Ms());
+					}
+					if (timings)
+					{
+						fprintf(timings, "%llu,%s,%.4f\n", interval.tag, PHASE_NAMES[phase], interval.Ms());
+					}
+					if (fractal::Trace::Enabled())
+					{
+						fractal::Trace::Complete(gpuTrack, PHASE_NAMES[phase],
+							gpuOriginUs + (double)((GLint64)interval.begin - gpuOriginNs) / 1000.0,
+							gpuOriginUs + (double)((GLint64)interval.end - gpuOriginNs) / 1000.0);
+					}
+				}
+			}
+			frameIndex++;
+
+			// Smaller frames while the view moves, from the compute times of frames before, and the whole
+			// one as soon as it stops. Scaled frames are computed whole: a progressive pass only says how
+			// long its share of the pixels took, which doesn't grow the frame back as the cost drops.
+			resolution.SetTargetMs(targetFrameMs);
+			const bool scaleDown = dynamicResolution && viewMoving && tileCacheActive == false;
+			const glm::ivec2 imageDim = scaleDown ? resolution.Dim() : glm::ivec2(gl::TEXTURE_DIM);
+			needDraw |= (imageDim != computedDim && viewMoving == false);
+			gpuEngine.SetProgressive(progressiveRefinement && scaleDown == false, refineBudgetMs);
+
+			fractal::Frame frame = fractal::MakeFrame(view, imageDim, iteration);
+
+			// Only frames that compute something, not to average in the idle ones
+			bool computeTimed = false;
+			double timedShare = 0.0;    // Of the frame the GPU computed in the timed interval, 0 if not a whole one
+			if (needDraw || lazyDraw == false || gpuEngine.RefinePending())
+			{
+				computeTimed = phaseTimers[PHASE_COMPUTE].Begin(frameIndex);
+			}
+
 			if (needDraw || lazyDraw == false)
 			{
-                graphicShader.Bind();
-                graphicShader.SetUniform1i("uIteration", iteration);
+				FRACTAL_TRACE_SCOPE("compute");
+				smoothComputed = false;
+				const uint32_t* hostPixels = nullptr;     // When the frame was computed on the CPU
+				auto computeStart = std::chrono::steady_clock::now();
+				if (tileCacheActive && fractal::TileCache::OnGrid(frame))
+				{
+					computeCached(frame, tileCache, useCpuEngine, cpuEngine, gpuEngine, tx, txSlot, tileReadback);
+					gpuEngine.InvalidateImage();
+				}
+				else if (usePerturbation)
+				{
+					if (useCpuEngine || gpuPerturbationEngine.Supported() == false)
+					{
+						perturbationEngine.Compute(frame);
+						hostPixels = perturbationEngine.Pixels().data();
+						tx.Bind(txSlot);
+						tx.UpdateSubPixelData({ 0, 0 }, perturbationEngine.PixelsDim(), hostPixels);
+					}
+					else
+					{
+						gpuPerturbationEngine.Compute(frame);
+						timedShare = 1.0;
+					}
+					gpuEngine.InvalidateImage();
+				}
+				else if (useCpuEngine && useBoundaryTrace)
+				{
+					traceEngine.Compute(frame);
+					hostPixels = traceEngine.Pixels().data();
+					tx.Bind(txSlot);
+					tx.UpdateSubPixelData({ 0, 0 }, traceEngine.PixelsDim(), hostPixels);
+					gpuEngine.InvalidateImage();
+				}
+				else if (useCpuEngine)
+				{
+					cpuEngine.Compute(frame);
+					hostPixels = cpuEngine.Pixels().data();
+					tx.Bind(txSlot);
+					tx.UpdateSubPixelData({ 0, 0 }, cpuEngine.PixelsDim(), hostPixels);
+					gpuEngine.InvalidateImage();
+				}
+				else
+				{
+					gpuEngine.Compute(frame);
+					smoothComputed = gpuEngine.WritesSmooth();
+
+					// Subdivided frames are whole ones, however little of them was computed
+					timedShare = gpuEngine.LastSubdivided() ? 1.0 : gpuEngine.LastComputedFraction();
+				}
+
+				// The GPU only uploaded frames computed on the CPU, timed here instead
+				if (hostPixels)
+				{
+					resolution.Measured(imageDim, 1.0,
+						std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - computeStart).count());
+				}
 
-				computeShader.Bind();
-				computeShader.SetUniform4f("uRangeRect",numberCenter.x - rangeX / 2, numberCenter.y - (rangeX / gl::ASPECT_RATIO) / 2, rangeX, (rangeX / gl::ASPECT_RATIO) );
-				computeShader.SetUniform1i("uIteration", iteration);
-				computeShader.compute({ gl::TEXTURE_DIM.x / gl::LOCAL_WORKGROUP_SIZE, gl::TEXTURE_DIM.y / gl::LOCAL_WORKGROUP_SIZE, 1});
+				if (imageDim != computedDim)
+				{
+					verteciesSrcRect(vertecies, gl::TEXTURE_DIM, { 0, 0, (float)imageDim.x, (float)imageDim.y });
+					vb.Bind();
+					vb.update(16 * sizeof(float), vertecies);
+					computedDim = imageDim;
+				}
 
+				computedIteration = iteration;
+				viewMoving = false;
 				needDraw = false;
-				glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+				// The next frame's iteration from this one's escapes, recomputed only if it went up
+				escapeStatsPending = autoIteration && hostPixels == nullptr;
+				if (autoIteration && hostPixels)
+				{
+					escapeStats = fractal::ReduceEscapeStats(hostPixels, frame.imageDim, frame.imageDim.x, frame.iteration);
+					iteration = fractal::PickIteration(escapeStats, frame.iteration, iterationBounds);
+					needDraw = (iteration > computedIteration);
+				}
+			}
+			else if (gpuEngine.RefinePending())
+			{
+				FRACTAL_TRACE_SCOPE("refine");
+				gpuEngine.Refine();
+			}
+
+			// Coarse progressive passes copy a pixel over a block and miss the thin filaments escaping
+			// late, which would lower the iteration too far: GPU frames wait for their last pass
+			if (escapeStatsPending && autoIteration && gpuEngine.RefinePending() == false)
+			{
+				escapeStatsPending = false;
+				escapeStats = gpuEscapeStats.Collect(computedDim, computedIteration);
+				iteration = fractal::PickIteration(escapeStats, computedIteration, iterationBounds);
+				needDraw |= (iteration > computedIteration);
+			}
+			phaseTimers[PHASE_COMPUTE].End();
+			if (computeTimed)
+			{
+				resolution.Submitted(imageDim, timedShare);
 			}
 
 			// Draw
 
-			glClear(GL_COLOR_BUFFER_BIT);
-			graphicShader.Bind();
-			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+			{
+				FRACTAL_TRACE_SCOPE("draw");
+				phaseTimers[PHASE_DRAW].Begin(frameIndex);
+				glClear(GL_COLOR_BUFFER_BIT);
+				graphicShader.Bind();
+				graphicShader.SetUniform1i("uIteration", iteration);
+				graphicShader.SetUniform1i("uSmooth", smoothComputed);
+				glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+				phaseTimers[PHASE_DRAW].End();
+			}
 
 			// Imgui window
 
@@ -194,34 +687,221 @@ int main()
 			ImGui_ImplGlfw_NewFrame();
 			ImGui::NewFrame();
 			{
+				FRACTAL_TRACE_SCOPE("imgui");
 				ImGui::Begin("ImGui Window Title");
 
 				ImGui::Checkbox("Lazy Draw", &lazyDraw);
+				ImGui::Checkbox("Dynamic Resolution", &dynamicResolution);
+				if (dynamicResolution)
+				{
+					const glm::ivec2 movingDim = resolution.Dim();
+					ImGui::SameLine();
+					ImGui::Text("(%dx%d while moving, %.2f ns per pixel)", movingDim.x, movingDim.y, resolution.MsPerPixel() * 1e6);
+					ImGui::SliderFloat("Target (ms)", &targetFrameMs, 4.0f, 100.0f, "%.1f");
+				}
+				if (ImGui::Checkbox("CPU Engine", &useCpuEngine))
+				{
+					needDraw = true;
+				}
+				if (ImGui::Checkbox("Deep Zoom (Perturbation)", &usePerturbation))
+				{
+					needDraw = true;
+					if (usePerturbation == false && view.rangeX < rangeMin)
+					{
+						view.rangeX = rangeMin;
+					}
+				}
+				if (usePerturbation)
+				{
+					needDraw |= ImGui::Checkbox("Series Approximation", &useSeriesApproximation);
+					perturbationEngine.SetSeriesApproximation(useSeriesApproximation);
+					gpuPerturbationEngine.SetSeriesApproximation(useSeriesApproximation);
+				}
+				if (usePerturbation == false)
+				{
+					needDraw |= ImGui::Checkbox("Tile Cache", &useTileCache);
+					if (useTileCache)
+					{
+						const auto stats = tileCache.GetStats();
+						ImGui::SameLine();
+						ImGui::Text("(%zu tiles, %.1f MB, %llu hits, %llu from disk, %llu misses)",
+							stats.tileCount, stats.bytes / 1048576.0, stats.hits, stats.diskHits, stats.misses);
+						if (stats.storedCount > 0)
+						{
+							const double rawBytes = (double)stats.storedCount * fractal::TileCache::TILE_SIZE * fractal::TileCache::TILE_SIZE * sizeof(uint32_t);
+							ImGui::Text("Spill file: %zu tiles, %.1f MB, %.1fx compressed",
+								stats.storedCount, stats.storedBytes / 1048576.0, rawBytes / (double)stats.storedBytes);
+						}
+					}
+				}
+				if (usePerturbation == false)
+				{
+					needDraw |= ImGui::Checkbox("Interior Checks", &useInteriorChecks);
+					cpuEngine.SetInteriorChecks(useInteriorChecks);
+					traceEngine.SetInteriorChecks(useInteriorChecks);
+					gpuEngine.SetInteriorChecks(useInteriorChecks);
+
+					needDraw |= ImGui::Checkbox("Mariani-Silver Subdivision", &useSubdivision);
+					cpuEngine.SetSubdivision(useSubdivision);
+					gpuEngine.SetSubdivision(useSubdivision);
+					if (useSubdivision && useCpuEngine)
+					{
+						ImGui::SameLine();
+						ImGui::Text("(%.1f%% computed)", cpuEngine.LastComputedFraction() * 100.0);
+					}
+					else if (useSubdivision && gpuEngine.LastPrecision() != fractal::Precision::FLOAT)
+					{
+						ImGui::SameLine();
+						ImGui::Text("(fp32 frames only)");
+					}
+				}
+				if (useCpuEngine && usePerturbation == false)
+				{
+					int isa = (int)cpuEngine.GetIsa();
+					for (int i = (int)fractal::Isa::SCALAR; i <= (int)fractal::DetectIsa(); i++)
+					{
+						if (i != (int)fractal::Isa::SCALAR) ImGui::SameLine();
+						needDraw |= ImGui::RadioButton(fractal::IsaName((fractal::Isa)i), &isa, i);
+					}
+					cpuEngine.SetIsa((fractal::Isa)isa);
 
-				ImGui::Text("x = %.5f", numberCenter.x);
-				ImGui::SameLine();
-				ImGui::Text("y = %.5f", numberCenter.y);
+					bool isDouble = (cpuEngine.GetPrecision() == fractal::Precision::DOUBLE);
+					needDraw |= ImGui::Checkbox("Double Precision", &isDouble);
+					cpuEngine.SetPrecision(isDouble ? fractal::Precision::DOUBLE : fractal::Precision::FLOAT);
+					traceEngine.SetPrecision(cpuEngine.GetPrecision());
+
+					needDraw |= ImGui::Checkbox("Boundary Tracing", &useBoundaryTrace);
+					if (useBoundaryTrace)
+					{
+						const auto stats = traceEngine.LastStats();
+						ImGui::SameLine();
+						ImGui::Text("(%.1f%% computed, %.1f ms)", stats.computedFraction * 100.0, stats.computeMs);
+					}
+				}
+
+				// Enough digits to tell pixels apart
+				const int centerDigits = 4 + (int)glm::max(0.0, -log10(view.rangeX));
+				ImGui::Text("x = %s", view.centerX.ToString(centerDigits).c_str());
+				ImGui::Text("y = %s", view.centerY.ToString(centerDigits).c_str());
+
+				ImGui::Text("range = %.5g", view.rangeX);
+				if (usePerturbation)
+				{
+					ImGui::SameLine();
+					if (useCpuEngine || gpuPerturbationEngine.Supported() == false)
+					{
+						const auto stats = perturbationEngine.LastStats();
+						ImGui::Text("(CPU, %u references, %u glitched pixels, skip %u)", stats.referenceCount, stats.glitchedPixels, stats.minTileSkip);
+					}
+					else
+					{
+						ImGui::Text("(GPU, %u references, skip %u)", gpuPerturbationEngine.LastReferenceCount(), gpuPerturbationEngine.LastSkip());
+					}
+				}
+				else if (useCpuEngine == false)
+				{
+					ImGui::SameLine();
+					ImGui::Text("(%s)", fractal::GpuEngine::PrecisionName(gpuEngine.LastPrecision()));
+
+					if (ImGui::Checkbox("Reuse Panned Pixels", &reusePannedPixels))
+					{
+						gpuEngine.SetReprojectionImage(reusePannedPixels ? &tx : nullptr);
+					}
+					ImGui::SameLine();
+					ImGui::Text("(%.1f%% recomputed)", gpuEngine.LastComputedFraction() * 100.0);
+
+					if (ImGui::Checkbox("Resume Iterations", &resumeIterations))
+					{
+						if (resumeIterations) gpuEngine.EnableIterationResume(resumeStateSlot);
+						else gpuEngine.DisableIterationResume();
+					}
+					if (gpuEngine.LastResumed())
+					{
+						ImGui::SameLine();
+						ImGui::Text("(resumed)");
+					}
+
+					if (ImGui::Checkbox("Smooth Coloring", &smoothColoring))
+					{
+						gpuEngine.SetSmoothImage(smoothColoring ? &txSmooth : nullptr, smoothImageSlot);
+						needDraw = true;
+					}
+
+					ImGui::Checkbox("Progressive Refinement", &progressiveRefinement);
+					if (progressiveRefinement)
+					{
+						ImGui::SameLine();
+						ImGui::Text("(1/%d)", gpuEngine.LastStride());
+						ImGui::SliderFloat("Budget (ms)", &refineBudgetMs, 1.0f, 50.0f, "%.1f");
+					}
 
-				ImGui::Text("range = %.5f", rangeX);
+					if (ImGui::Button("Benchmark Precisions"))
+					{
+						gpuEngine.Benchmark(frame, 10);
+					}
+					const auto& benchmark = gpuEngine.LastBenchmark();
+					if (benchmark.floatMs >= 0.0)
+					{
+						ImGui::Text("fp32 %.2f ms, fp32x2 %.2f ms, fp64 %.2f ms", benchmark.floatMs, benchmark.doubleFloatMs, benchmark.doubleMs);
+					}
+				}
 
 				ImGui::Text("iteration = %d", iteration);
+				needDraw |= ImGui::Checkbox("Automatic Iteration", &autoIteration);
+				if (autoIteration)
+				{
+					ImGui::DragIntRange2("Bounds", &iterationBounds.minIteration, &iterationBounds.maxIteration, 16.0f, 16, 1 << 20);
+					ImGui::Text("%.2f%% inside, %.2f%% late, highest escape %u",
+						escapeStats.inside * 100.0 / glm::max(escapeStats.pixels, 1ull),
+						escapeStats.late * 100.0 / glm::max(escapeStats.pixels, 1ull), escapeStats.maxEscape);
+
+					// Escapes per power of two, up to the iteration's
+					float histogram[fractal::EscapeStats::BINS];
+					int bins = 1;
+					for (int i = 0; i < fractal::EscapeStats::BINS; i++)
+					{
+						histogram[i] = (float)escapeStats.histogram[i];
+						if ((1 << i) < iteration) bins = i + 1;
+					}
+					ImGui::PlotHistogram("Escapes", histogram, bins, 0, "by power of two", 0.0f, FLT_MAX, ImVec2(0, 60));
+				}
 
 				ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
 				ImGui::SameLine();
 				ImGui::Text("(Delta Time %3.2f ms)", deltaTime * 1000.0f);
 
+				if (ImGui::CollapsingHeader("GPU Timings"))
+				{
+					for (int phase = 0; phase < PHASE_COUNT; phase++)
+					{
+						const gl::TimerStats& stats = phaseStats[phase];
+						ImGui::Text("%-7s min %6.2f  avg %6.2f  p99 %6.2f ms", PHASE_NAMES[phase],
+							stats.Min(), stats.Average(), stats.Percentile(0.99));
+						ImGui::PlotLines(PHASE_NAMES[phase], stats.Values(), stats.Count(), stats.Offset(),
+							nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+					}
+				}
+
 				ImGui::End();
 			}
 			ImGui::Render();
+			phaseTimers[PHASE_IMGUI].Begin(frameIndex);
 			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			phaseTimers[PHASE_IMGUI].End();
 
-			// Finish draw
+			// Finish draw, waiting on vsync
 
-            gl::Manager::WindowSwapBuffer();
+			{
+				FRACTAL_TRACE_SCOPE("swap");
+				gl::Manager::WindowSwapBuffer();
+			}
 
 			// Poll key events
 
-            gl::Manager::PollEvent();
+			{
+				FRACTAL_TRACE_SCOPE("poll events");
+				gl::Manager::PollEvent();
+			}
 
 			if (gl::Manager::KeyDown())
 			{
@@ -234,19 +914,44 @@ int main()
 
 				if (GL::KeyDown(GL::KEY_SHIFT))
 				{
+					// Octave steps with the tile cache on, once per press
+					const bool stepZoom = useTileCache && usePerturbation == false;
+
 					if (GL::KeyDown(GL::KEY_UP))
 					{
-                        rangeX *= (1.0f + deltaTime * rangeAddZoomPerSec);
-                        if (rangeX > 4.0f)
-                            rangeX = 4.0f;
+                        if (stepZoom == false || shiftUpPressed == false)
+                        {
+                            view.rangeX *= stepZoom ? 2.0 : (1.0 + deltaTime * rangeAddZoomPerSec);
+                            if (view.rangeX > 4.0)
+                                view.rangeX = 4.0;
+                            needDraw = true;
+                            viewMoving = true;
+                        }
+                        shiftUpPressed = true;
 					}
+                    else
+                    {
+                        shiftUpPressed = false;
+                    }
 
 					if (GL::KeyDown(GL::KEY_DOWN))
 					{
-                        rangeX *= (1.0f - deltaTime * rangeAddZoomPerSec);
-                        if (rangeX < 0.00005f)
-                            rangeX = 0.00005f;
+                        if (stepZoom == false || shiftDownPressed == false)
+                        {
+                            view.rangeX *= stepZoom ? 0.5 : (1.0 - deltaTime * rangeAddZoomPerSec);
+                            const double zoomMin = usePerturbation ? perturbationRangeMin : rangeMin;
+                            if (view.rangeX < zoomMin)
+                                view.rangeX = zoomMin;
+                            view.FitPrecision(gl::TEXTURE_DIM.x);
+                            needDraw = true;
+                            viewMoving = true;
+                        }
+                        shiftDownPressed = true;
 					}
+                    else
+                    {
+                        shiftDownPressed = false;
+                    }
 
 					if (GL::KeyDown(GL::KEY_LEFT))
 					{
@@ -269,6 +974,7 @@ int main()
                             shiftRightPressed = true;
                             if (iteration < 2048)
                                 iteration += 128;
+                            needDraw |= (iteration > computedIteration);
                         }
 					}
                     else
@@ -278,16 +984,36 @@ int main()
 				}
 				else
 				{
-                    float move = rangeX * deltaTime * rangeMovePerSec;
-					numberCenter.y += (float)(GL::KeyDown(GL::KEY_UP)) * move;
-                    numberCenter.y -= (float)(GL::KeyDown(GL::KEY_DOWN)) * move;
-                    numberCenter.x -= (float)(GL::KeyDown(GL::KEY_LEFT)) * move;
-                    numberCenter.x += (float)(GL::KeyDown(GL::KEY_RIGHT)) * move;
+                    double move = view.rangeX * deltaTime * rangeMovePerSec;
+                    glm::dvec2 moveDir = {
+                        (double)(GL::KeyDown(GL::KEY_RIGHT)) - (double)(GL::KeyDown(GL::KEY_LEFT)),
+                        (double)(GL::KeyDown(GL::KEY_UP)) - (double)(GL::KeyDown(GL::KEY_DOWN))
+                    };
+
+                    // Whole pixel steps, of the frames computed while moving, let the GPU engine reuse what
+                    // is still on screen
+                    const bool scaleDown = dynamicResolution && tileCacheActive == false;
+                    const double pixelSpacing = view.rangeX / (scaleDown ? resolution.Dim().x : gl::TEXTURE_DIM.x);
+                    panPixels += moveDir * move / pixelSpacing;
+                    const glm::dvec2 step = glm::trunc(panPixels);
+                    panPixels -= step;
+                    view.centerX += fractal::Fixed(step.x * pixelSpacing, view.centerX.LimbCount());
+                    view.centerY += fractal::Fixed(step.y * pixelSpacing, view.centerY.LimbCount());
+                    needDraw = true;
+                    viewMoving = true;
 				}
-
-				needDraw = true;
 			}
 		}
+
+		if (timings)
+		{
+			fclose(timings);
+		}
+		if (traceFile)
+		{
+			fractal::Trace::Stop();
+			fractal::Trace::Write(traceFile);
+		}
 	}
 
     return 0;
@@ -0,0 +1,644 @@
+// mandelbrot-render: renders one frame of the explorer without a window and writes it to a file,
+// in tiles streamed to disk when the picture is bigger than memory or a texture, or as a Deep Zoom
+// tile pyramid for web viewers. Also renders zoom videos, resampled from an exponential map.
+// Builds from this file plus MandelbrotGL/src (minus its main.cpp), on the same dependencies;
+// the GPU engines run on the headless backend and load their shaders from --res.
+
+#include "gl_manager.h"
+#include "gl_texture.h"
+
+#include "fractal_cpu_engine.h"
+#include "fractal_exponential_map.h"
+#include "fractal_gpu_engine.h"
+#include "fractal_gpu_perturbation_engine.h"
+#include "fractal_image.h"
+#include "fractal_perturbation_engine.h"
+#include "fractal_pyramid.h"
+#include "fractal_tiled_image.h"
+
+#include "glm.hpp"
+
+#include <chrono>
+#include <math.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+// Command line //////////////////////////////////////////////////
+
+enum class EngineType
+{
+    CPU, PERTURBATION, GPU, GPU_PERTURBATION
+};
+
+struct Options
+{
+    const char* centerX = "-0.25";
+    const char* centerY = "0";
+    double range = 4.0;             // Width in the complex plane
+    int iteration = 256;
+    glm::ivec2 dim = { 1920, 1080 };
+    int tile = 0;                   // Edge of the square tiles, 0 for one frame
+    EngineType engine = EngineType::CPU;
+    bool cpuFloat = false;
+    const char* resDir = "../MandelbrotGL/res";
+    const char* output = nullptr;
+    bool formatGiven = false;
+    fractal::ImageFormat format = fractal::ImageFormat::PNG;
+    bool pyramid = false;           // Output ends with ".dzi"
+    int frames = 0;                 // Zoom video when above 0
+    double zoomTo = 0.0;            // Width of its last frame
+    bool yuv = false;               // Output is "-" or ends with ".yuv"
+    std::string framePrefix;        // Frame paths around the number of numbered images
+    std::string frameSuffix;
+    int frameWidth = 0;             // Zero padded to, from %0Nd
+};
+
+static void printUsage()
+{
+    printf(
+        "usage: mandelbrot-render [options] output\n"
+        "  --center X,Y        view center, decimal at any precision (-0.25,0)\n"
+        "  --range W           width of the view in the complex plane (4)\n"
+        "  --iterations N      iteration cap (256)\n"
+        "  --size WxH          image size in pixels (1920x1080)\n"
+        "  --engine NAME       cpu, cpu-float, perturbation, gpu or gpu-perturbation (cpu)\n"
+        "  --tile N            render in NxN tiles streamed to the file, for tiff or raw\n"
+        "  --format NAME       png, ppm, raw or tiff, otherwise from the output extension\n"
+        "  --res DIR           shader directory for the GPU engines (../MandelbrotGL/res)\n"
+        "  --frames N          zoom video of N frames, from --range to --zoom-to\n"
+        "  --zoom-to W         width of the view in the last video frame\n"
+        "raw is one little endian uint32 escape iteration per pixel, top row first, 0 inside.\n"
+        "tiff is a tiled BigTIFF, in 1024x1024 tiles unless --tile says otherwise.\n"
+        "An output ending with .dzi makes a Deep Zoom pyramid of --tile sized PNG tiles (256).\n"
+        "Zoom videos are resampled from an exponential map the perturbation engine computes, whatever\n"
+        "--engine says. They go to numbered images when the output has one %%d or %%0Nd (frame%%05d.png),\n"
+        "or to a raw yuv420p stream when it ends with .yuv or is - for stdout:\n"
+        "  mandelbrot-render --frames 3600 --zoom-to 1e-10 ... - | ffmpeg -f rawvideo -pix_fmt yuv420p -s WxH -r 60 -i - zoom.mp4\n"
+    );
+}
+
+// The output of numbered images, split around its one %d or %0Nd: paths are then built
+// without it ever being given to printf as a format. %% stands for a percent sign.
+
+static bool parseFramePattern(const char* output, Options& options)
+{
+    bool numbered = false;
+    options.framePrefix.clear();
+    options.frameSuffix.clear();
+    for (const char* c = output; *c; c++)
+    {
+        std::string& text = numbered ? options.frameSuffix : options.framePrefix;
+        if (*c != '%')
+        {
+            text += *c;
+            continue;
+        }
+        if (c[1] == '%')
+        {
+            text += '%';
+            c++;
+            continue;
+        }
+        if (numbered)
+        {
+            return false;
+        }
+
+        const char* spec = c + 1;
+        int width = 0;
+        if (*spec == '0')
+        {
+            for (spec++; *spec >= '0' && *spec <= '9' && width < 100; spec++)
+            {
+                width = width * 10 + (*spec - '0');
+            }
+        }
+        if (*spec != 'd' || width >= 100)
+        {
+            return false;
+        }
+        options.frameWidth = width;
+        numbered = true;
+        c = spec;
+    }
+    return numbered;
+}
+
+static std::string framePath(const Options& options, int frame)
+{
+    const std::string number = std::to_string(frame);
+    const size_t padding = (number.size() < (size_t)options.frameWidth) ? options.frameWidth - number.size() : 0;
+    return options.framePrefix + std::string(padding, '0') + number + options.frameSuffix;
+}
+
+static bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const bool hasValue = (i + 1 < argc);
+
+        if (arg[0] != '-' || arg[1] != '-')
+        {
+            options.output = arg;
+            continue;
+        }
+        if (hasValue == false)
+        {
+            printf("Error: %s needs a value\n", arg);
+            return false;
+        }
+
+        const char* value = argv[++i];
+        if (strcmp(arg, "--center") == 0)
+        {
+            // Split in place, the halves stay in argv
+            char* comma = strchr(argv[i], ',');
+            if (comma == nullptr)
+            {
+                printf("Error: --center takes X,Y\n");
+                return false;
+            }
+            *comma = '\0';
+            options.centerX = value;
+            options.centerY = comma + 1;
+        }
+        else if (strcmp(arg, "--range") == 0)
+        {
+            options.range = atof(value);
+        }
+        else if (strcmp(arg, "--iterations") == 0)
+        {
+            options.iteration = atoi(value);
+        }
+        else if (strcmp(arg, "--size") == 0)
+        {
+            if (sscanf(value, "%dx%d", &options.dim.x, &options.dim.y) != 2)
+            {
+                printf("Error: --size takes WxH\n");
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--tile") == 0)
+        {
+            options.tile = atoi(value);
+        }
+        else if (strcmp(arg, "--engine") == 0)
+        {
+            if (strcmp(value, "cpu") == 0) options.engine = EngineType::CPU;
+            else if (strcmp(value, "cpu-float") == 0) { options.engine = EngineType::CPU; options.cpuFloat = true; }
+            else if (strcmp(value, "perturbation") == 0) options.engine = EngineType::PERTURBATION;
+            else if (strcmp(value, "gpu") == 0) options.engine = EngineType::GPU;
+            else if (strcmp(value, "gpu-perturbation") == 0) options.engine = EngineType::GPU_PERTURBATION;
+            else
+            {
+                printf("Error: unknown engine %s\n", value);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--format") == 0)
+        {
+            options.formatGiven = true;
+            if (strcmp(value, "png") == 0) options.format = fractal::ImageFormat::PNG;
+            else if (strcmp(value, "ppm") == 0) options.format = fractal::ImageFormat::PPM;
+            else if (strcmp(value, "raw") == 0) options.format = fractal::ImageFormat::RAW;
+            else if (strcmp(value, "tiff") == 0) options.format = fractal::ImageFormat::TIFF;
+            else
+            {
+                printf("Error: unknown format %s\n", value);
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--res") == 0)
+        {
+            options.resDir = value;
+        }
+        else if (strcmp(arg, "--frames") == 0)
+        {
+            options.frames = atoi(value);
+        }
+        else if (strcmp(arg, "--zoom-to") == 0)
+        {
+            options.zoomTo = atof(value);
+        }
+        else
+        {
+            printf("Error: unknown option %s\n", arg);
+            return false;
+        }
+    }
+
+    if (options.output == nullptr)
+    {
+        printf("Error: no output file\n");
+        return false;
+    }
+    if (options.dim.x <= 0 || options.dim.y <= 0 || options.iteration <= 0 || options.range <= 0.0 || options.tile < 0)
+    {
+        printf("Error: size, iterations and range have to be positive\n");
+        return false;
+    }
+
+    const size_t outputLength = strlen(options.output);
+    if (options.frames > 0)
+    {
+        options.yuv = (strcmp(options.output, "-") == 0) || (outputLength > 4 && strcmp(options.output + outputLength - 4, ".yuv") == 0);
+        options.format = fractal::FormatFromPath(options.output);
+        if (options.zoomTo <= 0.0 || options.zoomTo > options.range)
+        {
+            printf("Error: videos zoom in, --zoom-to has to be positive and at most --range\n");
+            return false;
+        }
+        if (options.yuv && (options.dim.x % 2 != 0 || options.dim.y % 2 != 0))
+        {
+            printf("Error: yuv420p needs an even size\n");
+            return false;
+        }
+        if (options.yuv == false && (parseFramePattern(options.output, options) == false ||
+            (options.format != fractal::ImageFormat::PNG && options.format != fractal::ImageFormat::PPM)))
+        {
+            printf("Error: video frames go to .png or .ppm files numbered by one %%d or %%0Nd, .yuv or -\n");
+            return false;
+        }
+        return true;
+    }
+
+    options.pyramid = (outputLength > 4 && strcmp(options.output + outputLength - 4, ".dzi") == 0);
+    if (options.pyramid)
+    {
+        options.tile = (options.tile == 0) ? 256 : options.tile;
+        return true;
+    }
+
+    if (options.formatGiven == false)
+    {
+        options.format = fractal::FormatFromPath(options.output);
+    }
+    if (options.format == fractal::ImageFormat::TIFF && options.tile == 0)
+    {
+        options.tile = 1024;
+    }
+    if (options.tile > 0 && options.format != fractal::ImageFormat::TIFF && options.format != fractal::ImageFormat::RAW)
+    {
+        printf("Error: tiles are only written to tiff or raw\n");
+        return false;
+    }
+    return true;
+}
+
+// Engines ///////////////////////////////////////////////////////
+
+// The engine of a run, kept for every frame it renders. GPU ones share a headless context
+// and a texture as big as the largest frame.
+
+class Renderer
+{
+public:
+
+    bool Init(const Options& options, glm::ivec2 maxDim)
+    {
+        engine = options.engine;
+        switch (engine)
+        {
+        case EngineType::CPU:
+            cpuEngine.reset(new fractal::CpuEngine(fractal::DetectIsa(), options.cpuFloat ? fractal::Precision::FLOAT : fractal::Precision::DOUBLE));
+            printf("ISA %s\n", fractal::IsaName(cpuEngine->GetIsa()));
+            return true;
+
+        case EngineType::PERTURBATION:
+            perturbationEngine.reset(new fractal::PerturbationEngine());
+            return true;
+
+        default:
+            return initGpu(options, maxDim);
+        }
+    }
+
+    // Bottom row first, frame.imageDim at most maxDim
+    bool Render(const fractal::Frame& frame, std::vector<uint32_t>& pixels)
+    {
+        switch (engine)
+        {
+        case EngineType::CPU:
+            cpuEngine->Compute(frame);
+            pixels = cpuEngine->Pixels();
+            return true;
+
+        case EngineType::PERTURBATION:
+            perturbationEngine->Compute(frame);
+            pixels = perturbationEngine->Pixels();
+            return true;
+
+        default:
+            return renderGpu(frame, pixels);
+        }
+    }
+
+    void PrintStats() const
+    {
+        if (perturbationEngine)
+        {
+            const auto stats = perturbationEngine->LastStats();
+            printf("%u references, %u glitched pixels, skip %u\n", stats.referenceCount, stats.glitchedPixels, stats.minTileSkip);
+        }
+        if (gpuPerturbationEngine)
+        {
+            printf("%u references, skip %u\n", gpuPerturbationEngine->LastReferenceCount(), gpuPerturbationEngine->LastSkip());
+        }
+        if (gpuEngine)
+        {
+            printf("Precision %s\n", fractal::GpuEngine::PrecisionName(gpuEngine->LastPrecision()));
+        }
+    }
+
+private:
+
+    static constexpr unsigned int txSlot = 0;
+    static constexpr unsigned int imageSlot = 2;
+    static constexpr unsigned int glitchMaskSlot = 3;
+
+    bool initGpu(const Options& options, glm::ivec2 maxDim)
+    {
+        if (gl::Manager::Init(gl::Manager::Backend::HEADLESS) == false)
+        {
+            return false;
+        }
+
+        GLint maxTextureSize = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+        if (maxDim.x > maxTextureSize || maxDim.y > maxTextureSize)
+        {
+            printf("Error: the GPU takes at most %dx%d, use --tile\n", maxTextureSize, maxTextureSize);
+            return false;
+        }
+
+        txDim = maxDim;
+        tx.reset(new gl::Texture(gl::TextureTarget::TEX2D, gl::PixelFormat::R32UI, gl::TextureWrap::CHOP));
+        tx->Bind(txSlot);
+        tx->UpdatePixelData(txDim, nullptr);
+        tx->BindToImageUnit(imageSlot, gl::ImageAccess::READ_WRITE);
+
+        const std::string res = options.resDir;
+        if (engine == EngineType::GPU_PERTURBATION)
+        {
+            gpuPerturbationEngine.reset(new fractal::GpuPerturbationEngine((res + "/mandelbrot_perturbation_cs.glsl").c_str(), imageSlot, glitchMaskSlot));
+            if (gpuPerturbationEngine->Supported() == false)
+            {
+                printf("Error: no fp64 on this GPU, use --engine perturbation\n");
+                return false;
+            }
+        }
+        else
+        {
+            const std::string floatPath = res + "/mandelbrot_cs.glsl";
+            const std::string doubleFloatPath = res + "/mandelbrot_df_cs.glsl";
+            const std::string doublePath = res + "/mandelbrot_fp64_cs.glsl";
+            gpuEngine.reset(new fractal::GpuEngine({ floatPath.c_str(), doubleFloatPath.c_str(), doublePath.c_str(), nullptr }, imageSlot));
+        }
+        return true;
+    }
+
+    bool renderGpu(const fractal::Frame& frame, std::vector<uint32_t>& pixels)
+    {
+        if (gpuPerturbationEngine)
+        {
+            gpuPerturbationEngine->Compute(frame);
+        }
+        else
+        {
+            gpuEngine->Compute(frame);
+        }
+
+        // The frame sits in the bottom left of the texture
+        readback.resize((size_t)txDim.x * txDim.y);
+        tx->Bind(txSlot);
+        tx->ReadPixelData(readback.data());
+
+        pixels.resize((size_t)frame.imageDim.x * frame.imageDim.y);
+        for (int y = 0; y < frame.imageDim.y; y++)
+        {
+            memcpy(pixels.data() + (size_t)y * frame.imageDim.x, readback.data() + (size_t)y * txDim.x, frame.imageDim.x * sizeof(uint32_t));
+        }
+
+        const GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            printf("Error: OpenGL error 0x%x\n", error);
+            return false;
+        }
+        return true;
+    }
+
+    EngineType engine = EngineType::CPU;
+    std::unique_ptr<fractal::CpuEngine> cpuEngine;
+    std::unique_ptr<fractal::PerturbationEngine> perturbationEngine;
+
+    std::unique_ptr<gl::Texture> tx;
+    glm::ivec2 txDim = { 0, 0 };
+    std::vector<uint32_t> readback;
+    std::unique_ptr<fractal::GpuEngine> gpuEngine;
+    std::unique_ptr<fractal::GpuPerturbationEngine> gpuPerturbationEngine;
+};
+
+// Tiles in rows from the top, each handed to the writer's thread as soon as it is done
+
+static bool renderTiled(const Options& options, const fractal::Frame& frame, Renderer& renderer)
+{
+    fractal::TiledImageWriter writer(options.output, options.format, frame.imageDim, glm::ivec2(options.tile), frame.iteration);
+    if (writer.Good() == false)
+    {
+        return false;
+    }
+
+    const glm::ivec2 tileCount = writer.TileCount();
+    for (int row = 0; row < tileCount.y; row++)
+    {
+        for (int column = 0; column < tileCount.x; column++)
+        {
+            const glm::ivec2 tile = { column, row };
+            const glm::ivec2 dim = writer.TileDim(tile);
+
+            // Frames count rows from the bottom
+            const glm::ivec2 offset = { writer.TileOffset(tile).x, frame.imageDim.y - writer.TileOffset(tile).y - dim.y };
+
+            std::vector<uint32_t> pixels;
+            if (renderer.Render(fractal::SubFrame(frame, offset, dim), pixels) == false || writer.Good() == false)
+            {
+                return false;
+            }
+            writer.Push(tile, std::move(pixels));
+        }
+        printf("\rRow %d of %d", row + 1, tileCount.y);
+        fflush(stdout);
+    }
+    printf("\n");
+
+    return writer.Close();
+}
+
+// Deepest level rendered tile by tile, the coarser ones downsampled on the pyramid's threads
+
+static bool renderPyramid(const Options& options, const fractal::Frame& frame, Renderer& renderer)
+{
+    fractal::DeepZoomPyramid pyramid(options.output, options.tile);
+
+    unsigned int rendered = 0;
+    const unsigned int deepestTiles = (unsigned int)(((frame.imageDim.x + options.tile - 1) / options.tile) * ((frame.imageDim.y + options.tile - 1) / options.tile));
+    const bool built = pyramid.Build(frame, [&](const fractal::Frame& tileFrame, std::vector<uint32_t>& pixels)
+    {
+        printf("\rTile %u of %u", ++rendered, deepestTiles);
+        fflush(stdout);
+        return renderer.Render(tileFrame, pixels);
+    });
+    printf("\n");
+
+    const auto stats = pyramid.LastStats();
+    printf("%d levels, %u tiles rendered, %u downsampled\n", stats.levelCount, stats.renderedTiles, stats.downsampledTiles);
+    return built;
+}
+
+// Frames zooming in at a steady rate, progress on stderr since the video may be on stdout
+
+static bool renderVideo(const Options& options, const fractal::View& view)
+{
+    fractal::ExponentialMap map(view.centerX, view.centerY, options.range, options.zoomTo, options.dim, options.iteration);
+    fprintf(stderr, "Exponential map of %d octaves, %dx%d each\n", map.OctaveCount(), map.OctaveDim().x, map.OctaveDim().y);
+
+    FILE* yuv = nullptr;
+    if (options.yuv)
+    {
+        if (strcmp(options.output, "-") == 0)
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            yuv = stdout;
+        }
+        else if ((yuv = fopen(options.output, "wb")) == nullptr)
+        {
+            fprintf(stderr, "Error: can't open %s for writing\n", options.output);
+            return false;
+        }
+    }
+
+    std::vector<uint8_t> rgb;
+    bool written = true;
+    unsigned int octaves = 0;
+    double computeMs = 0.0, resampleMs = 0.0;
+
+    for (int frame = 0; frame < options.frames && written; frame++)
+    {
+        const double t = (options.frames > 1) ? (double)frame / (options.frames - 1) : 0.0;
+        map.RenderFrame(options.range * pow(options.zoomTo / options.range, t), rgb);
+
+        const auto stats = map.LastStats();
+        octaves += stats.octavesComputed;
+        computeMs += stats.computeMs;
+        resampleMs += stats.resampleMs;
+
+        if (yuv)
+        {
+            written = fractal::WriteYuvFrame(yuv, rgb.data(), options.dim);
+        }
+        else
+        {
+            const std::string path = framePath(options, frame);
+            fractal::ImageWriter writer(path.c_str(), options.format, options.dim, options.iteration);
+            for (int y = 0; y < options.dim.y; y++)
+            {
+                writer.WriteColorRow(rgb.data() + (size_t)y * options.dim.x * 3);
+            }
+            written = writer.Close();
+        }
+
+        fprintf(stderr, "\rFrame %d of %d, %u octaves held", frame + 1, options.frames, stats.octavesHeld);
+    }
+    fprintf(stderr, "\n");
+
+    if (yuv && yuv != stdout)
+    {
+        written = (fclose(yuv) == 0) && written;
+    }
+    else if (yuv)
+    {
+        written = (fflush(yuv) == 0) && written;
+    }
+
+    fprintf(stderr, "%u octaves computed in %.2f ms, %d frames resampled in %.2f ms\n", octaves, computeMs, options.frames, resampleMs);
+    return written;
+}
+
+// Program ///////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (parseOptions(argc, argv, options) == false)
+    {
+        printUsage();
+        return -1;
+    }
+
+    // Enough limbs for the center to tell pixels apart, down to the last frame of a video
+    const double minRange = (options.frames > 0) ? options.zoomTo : options.range;
+    const int limbs = glm::max(2, fractal::Fixed::LimbsFor(minRange / options.dim.x));
+    fractal::View view = {
+        fractal::Fixed::FromString(options.centerX, limbs),
+        fractal::Fixed::FromString(options.centerY, limbs),
+        options.range
+    };
+    if (options.frames > 0)
+    {
+        return renderVideo(options, view) ? 0 : -1;
+    }
+
+    const fractal::Frame frame = fractal::MakeFrame(view, options.dim, options.iteration);
+
+    // One frame, unless it is tiled
+    const bool tiled = (options.tile > 0);
+    Renderer renderer;
+    if (renderer.Init(options, tiled ? glm::min(frame.imageDim, glm::ivec2(options.tile)) : frame.imageDim) == false)
+    {
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (options.pyramid)
+    {
+        if (renderPyramid(options, frame, renderer) == false)
+        {
+            return -1;
+        }
+    }
+    else if (tiled)
+    {
+        if (renderTiled(options, frame, renderer) == false)
+        {
+            return -1;
+        }
+    }
+    else
+    {
+        std::vector<uint32_t> pixels;
+        if (renderer.Render(frame, pixels) == false ||
+            fractal::WriteImage(options.output, options.format, pixels.data(), frame.imageDim, frame.iteration) == false)
+        {
+            return -1;
+        }
+        renderer.PrintStats();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    printf("%dx%d, %d iterations in %.2f ms, written to %s\n", frame.imageDim.x, frame.imageDim.y, frame.iteration,
+        std::chrono::duration<double, std::milli>(end - start).count(), options.output);
+    return 0;
+}
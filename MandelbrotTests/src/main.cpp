@@ -0,0 +1,191 @@
+// mandelbrot-tests: checks of the parts of MandelbrotGL that have an exact answer, without a GPU or
+// a window. Builds from this file plus MandelbrotGL/src/fractal_tile_store.cpp. Prints what failed
+// and exits with 1 if anything did.
+
+#include "fractal_tile_store.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+static void check(bool passed, const char* what, const std::string& detail)
+{
+    if (passed == false)
+    {
+        printf("FAIL %s (%s)\n", what, detail.c_str());
+        failures++;
+    }
+}
+
+// Tiles //////////////////////////////////////////////////
+
+typedef std::function<uint32_t(int x, int y)> TileFunction;
+
+static std::vector<uint32_t> makeTile(int tileSize, const TileFunction& function)
+{
+    std::vector<uint32_t> pixels((size_t)tileSize * tileSize);
+    for (int y = 0; y < tileSize; y++)
+    {
+        for (int x = 0; x < tileSize; x++)
+        {
+            pixels[(size_t)y * tileSize + x] = function(x, y);
+        }
+    }
+    return pixels;
+}
+
+// Escape iterations as the engines give them, 0 inside
+static uint32_t escapeIteration(double cx, double cy, uint32_t iteration)
+{
+    double x = 0.0, y = 0.0;
+    for (uint32_t i = 1; i <= iteration; i++)
+    {
+        const double xx = x * x, yy = y * y;
+        if (xx + yy > 4.0)
+        {
+            return i;
+        }
+        y = 2.0 * x * y + cy;
+        x = xx - yy + cx;
+    }
+    return 0;
+}
+
+struct NamedTile
+{
+    const char* name;
+    TileFunction function;
+};
+
+static std::vector<NamedTile> namedTiles()
+{
+    return {
+        { "inside", [](int, int) { return 0u; } },
+        { "constant", [](int, int) { return 7u; } },
+        { "gradient", [](int x, int y) { return (uint32_t)(x + 2 * y); } },
+        { "largest", [](int x, int y) { return ((x + y) % 2) ? 0xFFFFFFFFu : 0u; } },
+        { "noise", [](int x, int y) { uint32_t h = (uint32_t)(x * 2654435761u) ^ (uint32_t)(y * 40503u); h ^= h >> 15; return h * 2246822519u; } },
+        { "seahorse", [](int x, int y) { return escapeIteration(-0.7436447860 + x * 2e-6, 0.1318252536 + y * 2e-6, 2000); } },
+        { "whole set", [](int x, int y) { return escapeIteration(-2.0 + x * 2.5 / 128, -1.25 + y * 2.5 / 128, 256); } }
+    };
+}
+
+// Codec //////////////////////////////////////////////////
+
+static void testCodecRoundTrip()
+{
+    std::vector<uint8_t> residuals, encoded;
+    for (int tileSize : { 1, 2, 37, 128 })
+    {
+        for (const NamedTile& tile : namedTiles())
+        {
+            const std::vector<uint32_t> pixels = makeTile(tileSize, tile.function);
+            fractal::TileStore::Encode(pixels.data(), tileSize, residuals, encoded);
+
+            std::vector<uint32_t> decoded(pixels.size(), 0xDEADBEEFu);
+            const bool decodes = fractal::TileStore::Decode(encoded.data(), encoded.size(), tileSize, residuals, decoded.data());
+            const std::string detail = std::string(tile.name) + ", " + std::to_string(tileSize) + " pixels wide";
+            check(decodes && decoded == pixels, "codec round trip", detail);
+
+            // Every byte is needed, a shorter tile has to be refused rather than read past
+            if (encoded.size() > 1)
+            {
+                const bool truncatedDecodes = fractal::TileStore::Decode(encoded.data(), encoded.size() - 1, tileSize, residuals, decoded.data());
+                check(truncatedDecodes == false, "codec refuses a truncated tile", detail);
+            }
+        }
+    }
+}
+
+static void testCodecDamage()
+{
+    const int tileSize = 128;
+    const std::vector<uint32_t> pixels = makeTile(tileSize, namedTiles()[5].function);
+    std::vector<uint8_t> residuals, encoded;
+    fractal::TileStore::Encode(pixels.data(), tileSize, residuals, encoded);
+
+    // Damaged tiles may decode to other pixels, but never out of bounds (run it under ASan)
+    std::vector<uint32_t> decoded(pixels.size());
+    srand(1);
+    for (int i = 0; i < 2000; i++)
+    {
+        std::vector<uint8_t> damaged = encoded;
+        damaged[rand() % damaged.size()] ^= (uint8_t)(1 << (rand() % 8));
+        fractal::TileStore::Decode(damaged.data(), damaged.size(), tileSize, residuals, decoded.data());
+    }
+
+    check(fractal::TileStore::Decode(encoded.data(), 3, tileSize, residuals, decoded.data()) == false, "codec refuses a tile without its size", "3 bytes");
+}
+
+// Store //////////////////////////////////////////////////
+
+static void testStoreRoundTrip()
+{
+    const int tileSize = 64;
+    const std::string path = "mandelbrot-tests.mtil";
+    remove(path.c_str());
+
+    // Keys that only differ by engine or mode are different tiles
+    const fractal::TileKey keys[] = {
+        { 3, -2, 5, 256, fractal::Precision::DOUBLE, fractal::TileEngine::CPU_SCALAR, 0 },
+        { 3, -2, 5, 256, fractal::Precision::DOUBLE, fractal::TileEngine::CPU_AVX2, 0 },
+        { 3, -2, 5, 256, fractal::Precision::DOUBLE, fractal::TileEngine::CPU_SCALAR, fractal::TILE_SUBDIVISION },
+        { -40, 1ll << 40, -(1ll << 40), 100000, fractal::Precision::DOUBLE_FLOAT, fractal::TileEngine::GPU, 0 }
+    };
+    const int keyCount = (int)(sizeof(keys) / sizeof(keys[0]));
+    const std::vector<NamedTile> tiles = namedTiles();
+    auto tileOf = [&](int i) { return makeTile(tileSize, tiles[(i + 2) % tiles.size()].function); };
+
+    {
+        fractal::TileStore store(path.c_str(), tileSize);
+        check(store.Good(), "store created", path);
+        for (int i = 0; i < keyCount; i++)
+        {
+            store.Write(keys[i], tileOf(i).data());
+        }
+        check(store.TileCount() == (size_t)keyCount, "store keeps a tile per key", std::to_string(store.TileCount()) + " tiles");
+        check(store.Close(), "store closed", path);
+    }
+
+    {
+        fractal::TileStore store(path.c_str(), tileSize);
+        check(store.Good() && store.TileCount() == (size_t)keyCount, "store reopened", std::to_string(store.TileCount()) + " tiles");
+        for (int i = 0; i < keyCount; i++)
+        {
+            std::vector<uint32_t> read((size_t)tileSize * tileSize);
+            check(store.Read(keys[i], read.data()) && read == tileOf(i), "stored tile read back", "key " + std::to_string(i));
+        }
+
+        fractal::TileKey missing = keys[0];
+        missing.mode = 0xFF;
+        std::vector<uint32_t> read((size_t)tileSize * tileSize);
+        check(store.Read(missing, read.data()) == false, "store misses a key it never had", "other mode");
+        store.Close();
+    }
+
+    {
+        fractal::TileStore store(path.c_str(), tileSize * 2);
+        check(store.Good() == false, "store refuses another tile size", path);
+    }
+    remove(path.c_str());
+}
+
+int main()
+{
+    testCodecRoundTrip();
+    testCodecDamage();
+    testStoreRoundTrip();
+
+    if (failures > 0)
+    {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}